@@ -0,0 +1,158 @@
+// AVLAugmentations.hpp
+//
+// Augmentations for AVL trees that are commonly needed.  Any of them can be
+// passed as the Augmentation of an AVLSet, which then maintains the given
+// aggregate in every node (see AVLTree.hpp for how augmentation works).
+//
+// For example, an AVLSet<int, AVLCountAugmentation> supports order
+// statistics: aggregate(lo, hi) counts the elements in a range, and
+// findFirst() with the predicate "count > k" finds the element that has k
+// elements smaller than it.
+
+#ifndef AVLAUGMENTATIONS_HPP
+#define AVLAUGMENTATIONS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+
+// AVLCountAugmentation counts the values in each subtree.
+struct AVLCountAugmentation
+{
+    using AggregateType = std::size_t;
+
+    static AggregateType identity() noexcept
+    {
+        return 0;
+    }
+
+    template <typename ValueType>
+    static AggregateType of(const ValueType&) noexcept
+    {
+        return 1;
+    }
+
+    static AggregateType combine(AggregateType a, AggregateType b) noexcept
+    {
+        return a + b;
+    }
+};
+
+
+// AVLSumAugmentation sums the values in each subtree.
+template <typename ValueType>
+struct AVLSumAugmentation
+{
+    using AggregateType = ValueType;
+
+    static AggregateType identity()
+    {
+        return ValueType{};
+    }
+
+    static AggregateType of(const ValueType& value)
+    {
+        return value;
+    }
+
+    static AggregateType combine(const AggregateType& a, const AggregateType& b)
+    {
+        return a + b;
+    }
+};
+
+
+// AVLMinAugmentation finds the smallest value in each subtree.  The aggregate
+// of no values is the largest value a ValueType can have.
+template <typename ValueType>
+struct AVLMinAugmentation
+{
+    using AggregateType = ValueType;
+
+    static AggregateType identity()
+    {
+        return std::numeric_limits<ValueType>::max();
+    }
+
+    static AggregateType of(const ValueType& value)
+    {
+        return value;
+    }
+
+    static AggregateType combine(const AggregateType& a, const AggregateType& b)
+    {
+        return std::min(a, b);
+    }
+};
+
+
+// AVLMaxAugmentation finds the largest value in each subtree.  The aggregate
+// of no values is the smallest value a ValueType can have.
+template <typename ValueType>
+struct AVLMaxAugmentation
+{
+    using AggregateType = ValueType;
+
+    static AggregateType identity()
+    {
+        return std::numeric_limits<ValueType>::lowest();
+    }
+
+    static AggregateType of(const ValueType& value)
+    {
+        return value;
+    }
+
+    static AggregateType combine(const AggregateType& a, const AggregateType& b)
+    {
+        return std::max(a, b);
+    }
+};
+
+
+// AVLHashAugmentation keeps a fingerprint of the values in each subtree: the
+// sum of their hashes, each mixed so that its bits are spread evenly, which
+// wraps around on overflow.  A sum doesn't depend on the order of the values
+// or the shape of the tree they are in, so sets with the same elements have
+// the same fingerprints, over the whole set and over any range, however the
+// sets were built.  An AVLSet's aggregate() is then a fingerprint of its
+// contents, which takes O(1) time to find, and differences() can find where
+// two sets differ (see AVLSet.hpp).  Sets with different elements will have
+// the same fingerprint only by chance.
+template <typename ValueType, typename Hash = std::hash<ValueType>>
+struct AVLHashAugmentation
+{
+    using AggregateType = std::uint64_t;
+
+    static AggregateType identity() noexcept
+    {
+        return 0;
+    }
+
+    static AggregateType of(const ValueType& value)
+    {
+        // SplitMix64's increment and finalizer, since hashes such as
+        // std::hash<int> often return the value itself, and sums of those
+        // are easily equal.  The finalizer alone maps 0 to 0, which is the
+        // identity, so a value whose hash is 0 (as std::hash<int>(0) is)
+        // would leave no trace in a fingerprint.  The increment moves that
+        // to a hash no one is likely to produce, and the one value that
+        // still mixes to 0 is given another fingerprint.
+        std::uint64_t h = static_cast<std::uint64_t>(Hash{}(value)) + 0x9e3779b97f4a7c15u;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9u;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebu;
+        h ^= h >> 31;
+        return h != 0 ? h : 1;
+    }
+
+    static AggregateType combine(AggregateType a, AggregateType b) noexcept
+    {
+        return a + b;
+    }
+};
+
+
+#endif
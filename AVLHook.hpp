@@ -0,0 +1,367 @@
+// AVLHook.hpp
+//
+// An AVLHook is the part of an AVL tree node that links it into the tree:
+// its children, its parent and the height of its subtree.  AVLTree's nodes
+// are built on one, and so are the objects in an AVLIntrusiveSet, which
+// embed their own hooks so that they can be linked into a tree without
+// allocating a separate node.
+//
+// AVLHookAlgorithms are the operations that link nodes in and out of a
+// tree of AVLHooks and keep it balanced.  Every tree built on AVLHooks
+// shares this balancing code.  (ConcurrentAVLSet and StaticAVLSet aren't
+// built on AVLHooks, and do their own rotations.)  Since the algorithms
+// know nothing about what else a node holds, each of them takes an
+// "update" function, which is called on a node whenever its children change
+// so that its height, and anything else that depends on its subtree, can be
+// recomputed.
+//
+// The Tag of an AVLHook only distinguishes one hook from another, so that
+// an object can inherit several of them and be linked into several trees
+// at once.
+
+#ifndef AVLHOOK_HPP
+#define AVLHOOK_HPP
+
+#include <algorithm>
+#include <cstdlib>
+
+
+template <typename Tag = void>
+struct AVLHook
+{
+    // Initializes an AVLHook that is not linked into any tree.  Copying an
+    // object does not link the copy into the trees the original is in, so
+    // an AVLHook that is copied is also not linked into any tree, and one
+    // that is assigned to is left as it was.
+    AVLHook() noexcept
+        : child{nullptr, nullptr}, parent{nullptr}, height{0}
+    {
+    }
+
+    AVLHook(const AVLHook&) noexcept
+        : AVLHook{}
+    {
+    }
+
+    AVLHook& operator=(const AVLHook&) noexcept
+    {
+        return *this;
+    }
+
+    AVLHook* child[2];
+    AVLHook* parent;
+    int height;
+};
+
+
+template <typename HookType>
+class AVLHookAlgorithms
+{
+public:
+    // A hook's children are indexed by Direction.
+    enum Direction {Left = 0, Right = 1};
+
+public:
+    // height() returns the height of the given subtree, which is -1 if it
+    // is empty.
+    static int height(const HookType* t) noexcept;
+
+
+    // balance() returns how much taller the given node's left subtree is
+    // than its right subtree.
+    static int balance(const HookType* t) noexcept;
+
+
+    // extreme() returns the last node reached from t by following children
+    // in the given direction.
+    static HookType* extreme(HookType* t, int dir) noexcept;
+
+
+    // step() returns the node that comes after t in order, when dir is
+    // Right, or before it, when dir is Left, or nullptr if there is none.
+    // Stepping through all n nodes of a tree takes O(n) time in total.
+    static HookType* step(const HookType* t, int dir) noexcept;
+
+
+    // link() adds t to the tree with the given root, as the child in
+    // direction dir from parent (or as the root, if parent is nullptr),
+    // which must be where t's key belongs, then restores balance.  It
+    // returns the lowest node whose subtree is unchanged by the addition,
+    // or nullptr if every subtree above t has changed.
+    template <typename UpdateFunction>
+    static HookType* link(HookType*& root, HookType* t, HookType* parent, int dir,
+        bool shouldBalance, UpdateFunction&& update);
+
+
+    // unlink() removes t from the tree with the given root, then restores
+    // balance.  Like link(), it returns the lowest node whose subtree is
+    // unchanged by the removal.
+    template <typename UpdateFunction>
+    static HookType* unlink(HookType*& root, HookType* t, bool shouldBalance, UpdateFunction&& update);
+
+
+private:
+    static void relink(HookType*& root, HookType* parent, HookType* old, HookType* replacement) noexcept;
+
+    template <typename UpdateFunction>
+    static HookType* retrace(HookType*& root, HookType* t, bool shouldBalance, UpdateFunction& update);
+
+    template <typename UpdateFunction>
+    static HookType* rebalance(HookType* t, bool shouldBalance, UpdateFunction& update);
+
+    template <typename UpdateFunction>
+    static HookType* rotateSingle(HookType* t, int heavy, UpdateFunction& update);
+
+    template <typename UpdateFunction>
+    static HookType* rotateDouble(HookType* t, int heavy, UpdateFunction& update);
+};
+
+
+template <typename HookType>
+int AVLHookAlgorithms<HookType>::height(const HookType* t) noexcept
+{
+    if (t == nullptr)
+    {
+        return -1;
+    }
+    return t->height;
+}
+
+
+template <typename HookType>
+int AVLHookAlgorithms<HookType>::balance(const HookType* t) noexcept
+{
+    return height(t->child[Left]) - height(t->child[Right]);
+}
+
+
+template <typename HookType>
+HookType* AVLHookAlgorithms<HookType>::extreme(HookType* t, int dir) noexcept
+{
+    while (t->child[dir] != nullptr)
+    {
+        t = t->child[dir];
+    }
+    return t;
+}
+
+
+template <typename HookType>
+HookType* AVLHookAlgorithms<HookType>::step(const HookType* t, int dir) noexcept
+{
+    // If t has a subtree in the given direction, the next node that way is
+    // the nearest one in that subtree.  Otherwise, it's the nearest ancestor
+    // that t is on the other side of.
+    if (t->child[dir] != nullptr)
+    {
+        return extreme(t->child[dir], 1 - dir);
+    }
+
+    HookType* parent = t->parent;
+    while (parent != nullptr && t == parent->child[dir])
+    {
+        t = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+
+template <typename HookType>
+void AVLHookAlgorithms<HookType>::relink(HookType*& root, HookType* parent, HookType* old, HookType* replacement) noexcept
+{
+    if (parent == nullptr)
+    {
+        root = replacement;
+    } else
+    {
+        parent->child[parent->child[Right] == old] = replacement;
+    }
+    if (replacement != nullptr)
+    {
+        replacement->parent = parent;
+    }
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::link(HookType*& root, HookType* t, HookType* parent, int dir,
+    bool shouldBalance, UpdateFunction&& update)
+{
+    t->child[Left] = nullptr;
+    t->child[Right] = nullptr;
+    t->parent = parent;
+    update(t);
+
+    if (parent == nullptr)
+    {
+        root = t;
+    } else
+    {
+        parent->child[dir] = t;
+    }
+
+    return retrace(root, parent, shouldBalance, update);
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::unlink(HookType*& root, HookType* t, bool shouldBalance, UpdateFunction&& update)
+{
+    // The first node whose subtree lost a node, where retracing starts.
+    HookType* lowest;
+
+    if (t->child[Left] == nullptr || t->child[Right] == nullptr)
+    {
+        lowest = t->parent;
+        relink(root, t->parent, t, t->child[t->child[Left] == nullptr]);
+    } else
+    {
+        // The successor node itself takes t's place, rather than having its
+        // contents copied into t, since they need not be assignable.  It
+        // takes t's height, too, so that retracing can tell whether the
+        // height of the subtree it now roots has changed.
+        HookType* successor = extreme(t->child[Right], Left);
+        if (successor->parent == t)
+        {
+            lowest = successor;
+        } else
+        {
+            lowest = successor->parent;
+            relink(root, lowest, successor, successor->child[Right]);
+            successor->child[Right] = t->child[Right];
+            successor->child[Right]->parent = successor;
+        }
+        successor->child[Left] = t->child[Left];
+        successor->child[Left]->parent = successor;
+        successor->height = t->height;
+        relink(root, t->parent, t, successor);
+    }
+
+    t->child[Left] = nullptr;
+    t->child[Right] = nullptr;
+    t->parent = nullptr;
+
+    return retrace(root, lowest, shouldBalance, update);
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::retrace(HookType*& root, HookType* t, bool shouldBalance, UpdateFunction& update)
+{
+    // Walk from t up to the root, rebalancing each subtree whose height may
+    // have changed.  A subtree whose height is the same as it was before
+    // can't have unbalanced anything above it, so the walk stops there.
+    while (t != nullptr)
+    {
+        int oldHeight = t->height;
+        HookType* parent = t->parent;
+        HookType* subtree = rebalance(t, shouldBalance, update);
+        if (subtree != t)
+        {
+            relink(root, parent, t, subtree);
+        }
+
+        if (subtree->height == oldHeight)
+        {
+            return parent;
+        }
+        t = parent;
+    }
+    return nullptr;
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::rebalance(HookType* t, bool shouldBalance, UpdateFunction& update)
+{
+    // The rotation is chosen from the balance of the taller child, which
+    // works after both additions and removals.  If that child leans the
+    // other way from t, a single rotation would leave the tree unbalanced,
+    // so a double rotation is needed.
+    update(t);
+    int tBalance = balance(t);
+    if (!shouldBalance || std::abs(tBalance) <= 1)
+    {
+        return t;
+    }
+
+    int heavy = tBalance > 0 ? Left : Right;
+    int childBalance = balance(t->child[heavy]);
+    if (heavy == Left ? childBalance < 0 : childBalance > 0)
+    {
+        return rotateDouble(t, heavy, update);
+    }
+    return rotateSingle(t, heavy, update);
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::rotateSingle(HookType* t, int heavy, UpdateFunction& update)
+{
+    // The LL rotation when heavy is Left, and the RR rotation when it is
+    // Right: t's child on the heavy side takes t's place.
+    int light = 1 - heavy;
+    HookType* a = t->child[heavy];
+    HookType* t2 = a->child[light];
+
+    t->child[heavy] = t2;
+    a->child[light] = t;
+
+    a->parent = t->parent;
+    t->parent = a;
+    if (t2 != nullptr)
+    {
+        t2->parent = t;
+    }
+
+    update(t);
+    update(a);
+
+    return a;
+}
+
+
+template <typename HookType>
+template <typename UpdateFunction>
+HookType* AVLHookAlgorithms<HookType>::rotateDouble(HookType* t, int heavy, UpdateFunction& update)
+{
+    // The LR rotation when heavy is Left, and the RL rotation when it is
+    // Right: the grandchild between t and its heavy child takes t's place.
+    int light = 1 - heavy;
+    HookType* a = t->child[heavy];
+    HookType* b = a->child[light];
+    HookType* t2 = b->child[heavy];
+    HookType* t3 = b->child[light];
+
+    a->child[light] = t2;
+    t->child[heavy] = t3;
+    b->child[heavy] = a;
+    b->child[light] = t;
+
+    b->parent = t->parent;
+    a->parent = b;
+    t->parent = b;
+    if (t2 != nullptr)
+    {
+        t2->parent = a;
+    }
+    if (t3 != nullptr)
+    {
+        t3->parent = t;
+    }
+
+    update(a);
+    update(t);
+    update(b);
+
+    return b;
+}
+
+
+#endif
@@ -0,0 +1,228 @@
+// AVLIntervalSet.hpp
+//
+// An AVLIntervalSet is a set of closed intervals that can quickly find the
+// intervals overlapping a given one.  It is an AVL tree (see AVLTree.hpp)
+// ordered by the intervals' low endpoints, and augmented so that every node
+// knows the largest high endpoint in its subtree.  Since the rotations and
+// the paths of additions and removals keep that augmentation up to date,
+// a search for overlapping intervals can skip any subtree whose largest high
+// endpoint is below the query, and any right subtree whose low endpoints
+// all lie above it.  That takes O(min(n, k log n)) time to report k
+// intervals: each one reported can cost a path of O(log n) nodes that are
+// visited but pruned no further, so it's far better than the O(n) of
+// checking every interval when k is small, but not O(log n + k).  (Reaching
+// that bound takes a different structure, such as a centered interval tree,
+// which can't be kept balanced by an AVL tree's rotations alone.)
+
+#ifndef AVLINTERVALSET_HPP
+#define AVLINTERVALSET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include "AVLTree.hpp"
+
+
+// An Interval is the closed range of values from low to high.  Intervals
+// are ordered by their low endpoints, then by their high endpoints.
+template <typename EndpointType>
+struct Interval
+{
+    EndpointType low;
+    EndpointType high;
+
+    bool overlaps(const Interval& other) const
+    {
+        return !(high < other.low) && !(other.high < low);
+    }
+
+    bool operator==(const Interval& other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator<(const Interval& other) const
+    {
+        return low < other.low || (low == other.low && high < other.high);
+    }
+};
+
+
+template <typename EndpointType>
+class AVLIntervalSet
+{
+public:
+    // A VisitFunction is a function that takes a reference to a const
+    // Interval and returns no value.
+    using VisitFunction = std::function<void(const Interval<EndpointType>&)>;
+
+public:
+    // Initializes an AVLIntervalSet to be empty.  AVLIntervalSets can be
+    // copied and moved in the same ways as AVLSets.
+    AVLIntervalSet();
+
+
+    // add() adds an interval to the set.  If the interval is already in the
+    // set, this function has no effect.
+    void add(const Interval<EndpointType>& interval);
+
+
+    // remove() removes an interval from the set, returning true if it was in
+    // the set and false otherwise.
+    bool remove(const Interval<EndpointType>& interval);
+
+
+    // contains() returns true if the given interval is in the set, false
+    // otherwise.
+    bool contains(const Interval<EndpointType>& interval) const;
+
+
+    // overlapping() calls the given "visit" function for each interval in the
+    // set that overlaps the given one, in ascending order.  This function
+    // runs in O(min(n, k log n)) time when there are n intervals in the set
+    // and k of them overlap the given one.
+    void overlapping(const Interval<EndpointType>& interval, VisitFunction visit) const;
+
+
+    // stabbing() calls the given "visit" function for each interval in the
+    // set that contains the given point, in ascending order, in the same
+    // time as overlapping().
+    void stabbing(const EndpointType& point, VisitFunction visit) const;
+
+
+    // size() returns the number of intervals in the set.
+    std::size_t size() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const noexcept;
+
+
+    // inorder() calls the given "visit" function for each interval in the
+    // set, in ascending order.
+    void inorder(VisitFunction visit) const;
+
+
+private:
+    // Each node's aggregate is the largest high endpoint in its subtree.
+    struct MaxHigh
+    {
+        using AggregateType = EndpointType;
+
+        static AggregateType identity()
+        {
+            return std::numeric_limits<EndpointType>::lowest();
+        }
+
+        static AggregateType of(const Interval<EndpointType>& interval)
+        {
+            return interval.high;
+        }
+
+        static AggregateType combine(const AggregateType& a, const AggregateType& b)
+        {
+            return std::max(a, b);
+        }
+    };
+
+    using Tree = AVLTree<Interval<EndpointType>, Interval<EndpointType>, AVLIdentityKey, MaxHigh>;
+
+    Tree _tree;
+
+    void overlappingR(const typename Tree::Node* t, const Interval<EndpointType>& interval,
+        VisitFunction& visit) const;
+};
+
+
+template <typename EndpointType>
+AVLIntervalSet<EndpointType>::AVLIntervalSet()
+    : _tree{true}
+{
+}
+
+
+template <typename EndpointType>
+void AVLIntervalSet<EndpointType>::add(const Interval<EndpointType>& interval)
+{
+    _tree.emplace(interval, interval);
+}
+
+
+template <typename EndpointType>
+bool AVLIntervalSet<EndpointType>::remove(const Interval<EndpointType>& interval)
+{
+    return _tree.erase(interval);
+}
+
+
+template <typename EndpointType>
+bool AVLIntervalSet<EndpointType>::contains(const Interval<EndpointType>& interval) const
+{
+    return _tree.find(interval) != nullptr;
+}
+
+
+template <typename EndpointType>
+void AVLIntervalSet<EndpointType>::overlappingR(const typename Tree::Node* t,
+    const Interval<EndpointType>& interval, VisitFunction& visit) const
+{
+    if (t == nullptr || t->aggregate < interval.low)
+    {
+        return;
+    }
+
+    overlappingR(Tree::childOf(t, Tree::Left), interval, visit);
+
+    // Every interval from here to the right starts after this one does, so
+    // once this one starts after the query ends, none of them can overlap.
+    if (interval.high < t->value.low)
+    {
+        return;
+    }
+    if (t->value.overlaps(interval))
+    {
+        visit(t->value);
+    }
+
+    overlappingR(Tree::childOf(t, Tree::Right), interval, visit);
+}
+
+
+template <typename EndpointType>
+void AVLIntervalSet<EndpointType>::overlapping(const Interval<EndpointType>& interval, VisitFunction visit) const
+{
+    overlappingR(_tree.root(), interval, visit);
+}
+
+
+template <typename EndpointType>
+void AVLIntervalSet<EndpointType>::stabbing(const EndpointType& point, VisitFunction visit) const
+{
+    overlapping(Interval<EndpointType>{point, point}, visit);
+}
+
+
+template <typename EndpointType>
+std::size_t AVLIntervalSet<EndpointType>::size() const noexcept
+{
+    return _tree.size();
+}
+
+
+template <typename EndpointType>
+int AVLIntervalSet<EndpointType>::height() const noexcept
+{
+    return _tree.height();
+}
+
+
+template <typename EndpointType>
+void AVLIntervalSet<EndpointType>::inorder(VisitFunction visit) const
+{
+    _tree.inorder(visit);
+}
+
+
+#endif
@@ -0,0 +1,325 @@
+// AVLIntrusiveSet.hpp
+//
+// An AVLIntrusiveSet is an AVL tree of objects that it does not own.  Rather
+// than allocating a node for each object, it links the objects themselves
+// together, through an AVLHook (see AVLHook.hpp) that each object inherits.
+// Adding an object never allocates, and removing one never frees anything;
+// the objects stay wherever their owner put them.
+//
+// An object can be in more than one AVLIntrusiveSet at once by inheriting
+// one AVLHook for each, distinguished by their Tags, with each set ordering
+// the objects by a key that its KeyOfValue extracts (see AVLTree.hpp).  For
+// example:
+//
+//     struct ById;
+//     struct ByName;
+//
+//     struct Employee : AVLHook<ById>, AVLHook<ByName>
+//     {
+//         int id;
+//         std::string name;
+//     };
+//
+//     struct IdOf
+//     {
+//         static const int& get(const Employee& e) { return e.id; }
+//     };
+//
+//     AVLIntrusiveSet<Employee, IdOf, ById> byId;
+//
+// The balancing is done by the same AVLHookAlgorithms as in an AVLSet.  An
+// object must be removed from a set before it is destroyed, and its key
+// must not change while it is in one.
+
+#ifndef AVLINTRUSIVESET_HPP
+#define AVLINTRUSIVESET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "AVLHook.hpp"
+#include "AVLTree.hpp"
+
+
+template <typename ObjectType, typename KeyOfValue = AVLIdentityKey, typename Tag = void>
+class AVLIntrusiveSet
+{
+public:
+    using HookType = AVLHook<Tag>;
+
+    using KeyType = std::decay_t<decltype(KeyOfValue::get(std::declval<const ObjectType&>()))>;
+
+    // A VisitFunction is a function that takes a reference to an object and
+    // returns no value.
+    using VisitFunction = std::function<void(ObjectType&)>;
+
+public:
+    // Initializes an AVLIntrusiveSet to be empty, with or without balancing.
+    explicit AVLIntrusiveSet(bool shouldBalance = true);
+
+    // Unlinks every object that is still in the set, so that each can be
+    // added to another set afterward.
+    ~AVLIntrusiveSet() noexcept;
+
+    // AVLIntrusiveSets cannot be copied, since an object's hook can only
+    // link it into one set at a time, but they can be moved.
+    AVLIntrusiveSet(const AVLIntrusiveSet&) = delete;
+    AVLIntrusiveSet& operator=(const AVLIntrusiveSet&) = delete;
+
+    AVLIntrusiveSet(AVLIntrusiveSet&& s) noexcept;
+    AVLIntrusiveSet& operator=(AVLIntrusiveSet&& s) noexcept;
+
+
+    // add() links the given object into the set and returns true, unless
+    // the set already has an object with the same key, in which case it
+    // returns false and the object is not linked.  This function always
+    // runs in O(log n) time when there are n objects in the set, and never
+    // allocates memory.
+    bool add(ObjectType& object);
+
+
+    // unlink() removes the given object, which must be in the set, without
+    // searching for it.
+    void unlink(ObjectType& object);
+
+
+    // remove() removes the object with the given key, returning a pointer to
+    // it, or nullptr if there is no such object.  This function always runs
+    // in O(log n) time.
+    ObjectType* remove(const KeyType& key);
+
+
+    // find() returns a pointer to the object with the given key, or nullptr
+    // if there is no such object.  This function always runs in O(log n)
+    // time.
+    ObjectType* find(const KeyType& key) const;
+
+
+    // contains() returns true if there is an object with the given key in
+    // the set, false otherwise.
+    bool contains(const KeyType& key) const;
+
+
+    // clear() unlinks every object in the set.  This function runs in O(n)
+    // time.
+    void clear() noexcept;
+
+
+    // size() returns the number of objects in the set.
+    std::size_t size() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const noexcept;
+
+
+    // inorder() calls the given "visit" function for each object in the set,
+    // in ascending order of keys.
+    void inorder(VisitFunction visit) const;
+
+
+private:
+    using Links = AVLHookAlgorithms<HookType>;
+
+    HookType* _root;
+    std::size_t _sz;
+    bool _shouldBalance;
+
+    static ObjectType* objectOf(HookType* h) noexcept;
+
+    static const KeyType& keyOf(HookType* h) noexcept;
+
+    static void updateNode(HookType* h) noexcept;
+
+    void clearR(HookType* h) noexcept;
+
+    void inorderR(VisitFunction& visit, HookType* h) const;
+};
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::AVLIntrusiveSet(bool shouldBalance)
+    : _root{nullptr}, _sz{0}, _shouldBalance{shouldBalance}
+{
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::~AVLIntrusiveSet() noexcept
+{
+    clear();
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::AVLIntrusiveSet(AVLIntrusiveSet&& s) noexcept
+    : _root{nullptr}, _sz{0}, _shouldBalance{true}
+{
+    std::swap(_root, s._root);
+    std::swap(_sz, s._sz);
+    std::swap(_shouldBalance, s._shouldBalance);
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>& AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::operator=(
+    AVLIntrusiveSet&& s) noexcept
+{
+    std::swap(_root, s._root);
+    std::swap(_sz, s._sz);
+    std::swap(_shouldBalance, s._shouldBalance);
+
+    return *this;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+ObjectType* AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::objectOf(HookType* h) noexcept
+{
+    return static_cast<ObjectType*>(h);
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+const typename AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::KeyType&
+AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::keyOf(HookType* h) noexcept
+{
+    return KeyOfValue::get(*objectOf(h));
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::updateNode(HookType* h) noexcept
+{
+    h->height = 1 + std::max(Links::height(h->child[Links::Left]), Links::height(h->child[Links::Right]));
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+bool AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::add(ObjectType& object)
+{
+    const KeyType& key = KeyOfValue::get(object);
+    HookType* parent = nullptr;
+    int dir = Links::Left;
+    HookType* cur = _root;
+    while (cur != nullptr)
+    {
+        if (keyOf(cur) == key)
+        {
+            return false;
+        }
+        parent = cur;
+        dir = key < keyOf(cur) ? Links::Left : Links::Right;
+        cur = cur->child[dir];
+    }
+
+    Links::link(_root, static_cast<HookType*>(&object), parent, dir, _shouldBalance, updateNode);
+    ++_sz;
+    return true;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::unlink(ObjectType& object)
+{
+    Links::unlink(_root, static_cast<HookType*>(&object), _shouldBalance, updateNode);
+    --_sz;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+ObjectType* AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::remove(const KeyType& key)
+{
+    ObjectType* object = find(key);
+    if (object != nullptr)
+    {
+        unlink(*object);
+    }
+    return object;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+ObjectType* AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::find(const KeyType& key) const
+{
+    HookType* cur = _root;
+    while (cur != nullptr)
+    {
+        if (keyOf(cur) == key)
+        {
+            return objectOf(cur);
+        }
+        cur = cur->child[key < keyOf(cur) ? Links::Left : Links::Right];
+    }
+    return nullptr;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+bool AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::contains(const KeyType& key) const
+{
+    return find(key) != nullptr;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::clearR(HookType* h) noexcept
+{
+    if (h != nullptr)
+    {
+        clearR(h->child[Links::Left]);
+        clearR(h->child[Links::Right]);
+        h->child[Links::Left] = nullptr;
+        h->child[Links::Right] = nullptr;
+        h->parent = nullptr;
+        h->height = 0;
+    }
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::clear() noexcept
+{
+    clearR(_root);
+    _root = nullptr;
+    _sz = 0;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+std::size_t AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::size() const noexcept
+{
+    return _sz;
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+int AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::height() const noexcept
+{
+    return Links::height(_root);
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::inorderR(VisitFunction& visit, HookType* h) const
+{
+    if (h != nullptr)
+    {
+        inorderR(visit, h->child[Links::Left]);
+        visit(*objectOf(h));
+        inorderR(visit, h->child[Links::Right]);
+    }
+}
+
+
+template <typename ObjectType, typename KeyOfValue, typename Tag>
+void AVLIntrusiveSet<ObjectType, KeyOfValue, Tag>::inorder(VisitFunction visit) const
+{
+    inorderR(visit, _root);
+}
+
+
+#endif
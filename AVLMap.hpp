@@ -0,0 +1,274 @@
+// AVLMap.hpp
+//
+// An AVLMap associates a value with each of a set of unique keys.  It is
+// built on the same AVL tree engine as AVLSet (see AVLTree.hpp), with each
+// key stored in the same node as its value, so that looking up, adding or
+// updating a key's value takes a single descent of the tree.  As with an
+// AVLSet, balancing can be turned off by passing false to the constructor.
+//
+// An AVLMap can also be given an Augmentation (see AVLTree.hpp) whose of()
+// takes a key/value pair, such as one that sums the values.  In that case,
+// values can only be changed through insertOrAssign() or update(), which
+// keep the aggregates up to date: find() and tryEmplace() return pointers to
+// const values, and operator[] can't be used at all.
+
+#ifndef AVLMAP_HPP
+#define AVLMAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "AVLTree.hpp"
+
+
+template <typename KeyType, typename ValueType, typename Augmentation = AVLNoAugmentation>
+class AVLMap
+{
+public:
+    // A VisitFunction is a function that takes a reference to a const
+    // KeyType and a reference to its const ValueType and returns no value.
+    using VisitFunction = std::function<void(const KeyType&, const ValueType&)>;
+
+    // An AggregateType is what the Augmentation computes over the key/value
+    // pairs in a range; it is void if the map is not augmented.
+    using AggregateType = typename Augmentation::AggregateType;
+
+    // A ValueAccessType is what find() and tryEmplace() point to: a
+    // ValueType, or a const one if the map is augmented, since changing a
+    // value behind the map's back would leave the aggregates above it stale.
+    using ValueAccessType = std::conditional_t<std::is_void_v<AggregateType>, ValueType, const ValueType>;
+
+public:
+    // Initializes an AVLMap to be empty, with or without balancing.  AVLMaps
+    // can be copied and moved in the same ways as AVLSets.
+    explicit AVLMap(bool shouldBalance = true);
+
+
+    // contains() returns true if the given key is in the map, false
+    // otherwise.  This function always runs in O(log n) time when there are
+    // n keys in the AVL tree.
+    bool contains(const KeyType& key) const;
+
+
+    // find() returns a pointer to the value associated with the given key,
+    // or nullptr if the key is not in the map.  The pointer remains valid
+    // until the key is removed, or the map is destroyed or assigned to.
+    // This function always runs in O(log n) time when there are n keys in
+    // the AVL tree.
+    ValueAccessType* find(const KeyType& key);
+    const ValueType* find(const KeyType& key) const;
+
+
+    // operator[] returns the value associated with the given key, first
+    // adding the key with a default-constructed value if it is not already
+    // in the map.  Augmented maps don't have it, since it would allow their
+    // values to be changed without updating their aggregates.
+    ValueType& operator[](const KeyType& key);
+
+
+    // insertOrAssign() associates the given value with the given key,
+    // replacing the key's existing value if it has one.  It returns true if
+    // the key was added, false if it was already in the map.
+    bool insertOrAssign(const KeyType& key, const ValueType& value);
+
+
+    // tryEmplace() adds the given key with a value constructed from "args",
+    // unless the key is already in the map, in which case nothing is
+    // constructed.  It returns a pointer to the key's value, and whether
+    // the key was added.
+    template <typename... Args>
+    std::pair<ValueAccessType*, bool> tryEmplace(const KeyType& key, Args&&... args);
+
+
+    // update() calls the given "modify" function with a reference to the
+    // value associated with the given key, so that the value can be changed
+    // in place.  It returns true if the key was found, false otherwise.
+    template <typename ModifyFunction>
+    bool update(const KeyType& key, ModifyFunction modify);
+
+
+    // remove() removes the given key and its value from the map, returning
+    // true if the key was in the map and false otherwise.
+    bool remove(const KeyType& key);
+
+
+    // aggregate() returns the aggregate of every key and value in the map.
+    // Only augmented maps have aggregates.
+    AggregateType aggregate() const;
+
+
+    // aggregate() returns the aggregate of the keys that are at least lo and
+    // less than hi, along with their values.  This function always runs in
+    // O(log n) time when there are n keys in the AVL tree.
+    AggregateType aggregate(const KeyType& lo, const KeyType& hi) const;
+
+
+    // size() returns the number of keys in the map.
+    std::size_t size() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const noexcept;
+
+
+    // preorder(), inorder() and postorder() call the given "visit" function
+    // for each key and its value, in the order determined by the respective
+    // traversal of the AVL tree.  An inorder traversal visits the keys in
+    // ascending order.
+    void preorder(VisitFunction visit) const;
+
+    void inorder(VisitFunction visit) const;
+
+    void postorder(VisitFunction visit) const;
+
+
+private:
+    AVLTree<KeyType, std::pair<const KeyType, ValueType>, AVLPairKey, Augmentation> _tree;
+};
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+AVLMap<KeyType, ValueType, Augmentation>::AVLMap(bool shouldBalance)
+    : _tree{shouldBalance}
+{
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+bool AVLMap<KeyType, ValueType, Augmentation>::contains(const KeyType& key) const
+{
+    return _tree.find(key) != nullptr;
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+typename AVLMap<KeyType, ValueType, Augmentation>::ValueAccessType*
+AVLMap<KeyType, ValueType, Augmentation>::find(const KeyType& key)
+{
+    auto node = _tree.find(key);
+    return node == nullptr ? nullptr : &node->value.second;
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+const ValueType* AVLMap<KeyType, ValueType, Augmentation>::find(const KeyType& key) const
+{
+    auto node = _tree.find(key);
+    return node == nullptr ? nullptr : &node->value.second;
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+ValueType& AVLMap<KeyType, ValueType, Augmentation>::operator[](const KeyType& key)
+{
+    static_assert(std::is_void_v<AggregateType>,
+        "operator[] would allow an augmented AVLMap's values to change without updating its aggregates; "
+        "use insertOrAssign() or update() instead");
+
+    return *tryEmplace(key).first;
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+bool AVLMap<KeyType, ValueType, Augmentation>::insertOrAssign(const KeyType& key, const ValueType& value)
+{
+    std::pair<ValueAccessType*, bool> result = tryEmplace(key, value);
+    if (!result.second)
+    {
+        if constexpr (std::is_void_v<AggregateType>)
+        {
+            *result.first = value;
+        } else
+        {
+            _tree.modify(key, [&](std::pair<const KeyType, ValueType>& p) { p.second = value; });
+        }
+    }
+    return result.second;
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+template <typename... Args>
+std::pair<typename AVLMap<KeyType, ValueType, Augmentation>::ValueAccessType*, bool>
+AVLMap<KeyType, ValueType, Augmentation>::tryEmplace(const KeyType& key, Args&&... args)
+{
+    auto result = _tree.emplace(
+        key, std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+
+    return {&result.first->value.second, result.second};
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+template <typename ModifyFunction>
+bool AVLMap<KeyType, ValueType, Augmentation>::update(const KeyType& key, ModifyFunction modify)
+{
+    return _tree.modify(key, [&](std::pair<const KeyType, ValueType>& p) { modify(p.second); });
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+bool AVLMap<KeyType, ValueType, Augmentation>::remove(const KeyType& key)
+{
+    return _tree.erase(key);
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+typename AVLMap<KeyType, ValueType, Augmentation>::AggregateType AVLMap<KeyType, ValueType, Augmentation>::aggregate() const
+{
+    return _tree.aggregate(nullptr, nullptr);
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+typename AVLMap<KeyType, ValueType, Augmentation>::AggregateType AVLMap<KeyType, ValueType, Augmentation>::aggregate(
+    const KeyType& lo, const KeyType& hi) const
+{
+    return _tree.aggregate(&lo, &hi);
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+std::size_t AVLMap<KeyType, ValueType, Augmentation>::size() const noexcept
+{
+    return _tree.size();
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+int AVLMap<KeyType, ValueType, Augmentation>::height() const noexcept
+{
+    return _tree.height();
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+void AVLMap<KeyType, ValueType, Augmentation>::preorder(VisitFunction visit) const
+{
+    _tree.preorder(
+        [&](const std::pair<const KeyType, ValueType>& p) { visit(p.first, p.second); });
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+void AVLMap<KeyType, ValueType, Augmentation>::inorder(VisitFunction visit) const
+{
+    _tree.inorder(
+        [&](const std::pair<const KeyType, ValueType>& p) { visit(p.first, p.second); });
+}
+
+
+template <typename KeyType, typename ValueType, typename Augmentation>
+void AVLMap<KeyType, ValueType, Augmentation>::postorder(VisitFunction visit) const
+{
+    _tree.postorder(
+        [&](const std::pair<const KeyType, ValueType>& p) { visit(p.first, p.second); });
+}
+
+
+#endif
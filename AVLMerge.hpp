@@ -0,0 +1,223 @@
+// AVLMerge.hpp
+//
+// An AVLMerge is the union of several AVLSets (or any other sets whose
+// ConstIterators visit their elements in ascending order), seen in
+// ascending order without copying any of them into a new set.  Iterating
+// through it merges the sets as it goes: a heap holds one iterator into each
+// set that has elements left, the smallest of their elements is the next one
+// in the merge, and an element that is in several of the sets is seen only
+// once.  For example:
+//
+//     AVLSet<int> a, b, c;
+//     ...
+//     for (int i : AVLMerge<AVLSet<int>>{a, b, c})
+//     {
+//         ...
+//     }
+//
+// Beginning an iteration takes O(k) time for k sets, and each step after
+// that takes O(log k) time for every set that the element being stepped
+// past is in, so visiting all n elements of the union takes O(n log k) time
+// at worst.  Like the ConstIterators it's built on, an AVLMerge's
+// ConstIterator remains valid until an element it refers to is removed from
+// its set.
+
+#ifndef AVLMERGE_HPP
+#define AVLMERGE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+
+template <typename SetType>
+class AVLMerge
+{
+public:
+    using SetIterator = typename SetType::ConstIterator;
+
+    using ElementType = typename std::iterator_traits<SetIterator>::value_type;
+
+    // A ConstIterator visits the elements of the union in ascending order,
+    // each one once, no matter how many of the sets it is in.
+    class ConstIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ElementType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ElementType*;
+        using reference = const ElementType&;
+
+        ConstIterator() = default;
+
+        reference operator*() const noexcept
+        {
+            return *_heap.front().current;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &*_heap.front().current;
+        }
+
+        ConstIterator& operator++();
+
+        ConstIterator operator++(int)
+        {
+            ConstIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        // Every set's element is visited once, so two iterators over the
+        // same merge are at the same place exactly when the iterators at
+        // the tops of their heaps are.
+        bool operator==(const ConstIterator& i) const noexcept
+        {
+            if (_heap.empty() || i._heap.empty())
+            {
+                return _heap.empty() && i._heap.empty();
+            }
+            return _heap.front().current == i._heap.front().current;
+        }
+
+        bool operator!=(const ConstIterator& i) const noexcept
+        {
+            return !(*this == i);
+        }
+
+    private:
+        // A Cursor is the place reached so far in one of the sets.
+        struct Cursor
+        {
+            SetIterator current;
+            SetIterator end;
+        };
+
+        // The heap has the Cursor with the smallest element on top.
+        static bool comesAfter(const Cursor& a, const Cursor& b)
+        {
+            return *b.current < *a.current;
+        }
+
+        std::vector<Cursor> _heap;
+
+        friend class AVLMerge;
+    };
+
+public:
+    // Initializes an AVLMerge of no sets at all.
+    AVLMerge() = default;
+
+    // Initializes an AVLMerge of the given sets, which must outlive it.
+    AVLMerge(std::initializer_list<std::reference_wrapper<const SetType>> sets);
+
+    // Initializes an AVLMerge of the sets in the range [first, last), which
+    // must outlive it.
+    template <typename InputIterator>
+    AVLMerge(InputIterator first, InputIterator last);
+
+
+    // add() adds another set to the merge.  Iterators that already exist
+    // are unaffected.
+    void add(const SetType& s);
+
+
+    // begin() returns an iterator to the smallest element in any of the
+    // sets, or end() if all of them are empty.  This function runs in O(k)
+    // time when there are k sets.
+    ConstIterator begin() const;
+
+    ConstIterator end() const noexcept;
+
+
+private:
+    std::vector<const SetType*> _sets;
+};
+
+
+template <typename SetType>
+typename AVLMerge<SetType>::ConstIterator& AVLMerge<SetType>::ConstIterator::operator++()
+{
+    // Every set whose next element is the one being stepped past moves on to
+    // its following element, so that the element isn't seen twice.  The
+    // element lives in a set's node, so it stays put while they do.
+    const ElementType& element = **this;
+    do
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), comesAfter);
+        Cursor& stepped = _heap.back();
+        ++stepped.current;
+        if (stepped.current == stepped.end)
+        {
+            _heap.pop_back();
+        } else
+        {
+            std::push_heap(_heap.begin(), _heap.end(), comesAfter);
+        }
+    } while (!_heap.empty() && !(element < *_heap.front().current));
+
+    return *this;
+}
+
+
+template <typename SetType>
+AVLMerge<SetType>::AVLMerge(std::initializer_list<std::reference_wrapper<const SetType>> sets)
+{
+    _sets.reserve(sets.size());
+    for (const SetType& s : sets)
+    {
+        _sets.push_back(&s);
+    }
+}
+
+
+template <typename SetType>
+template <typename InputIterator>
+AVLMerge<SetType>::AVLMerge(InputIterator first, InputIterator last)
+{
+    for (; first != last; ++first)
+    {
+        const SetType& s = *first;
+        _sets.push_back(&s);
+    }
+}
+
+
+template <typename SetType>
+void AVLMerge<SetType>::add(const SetType& s)
+{
+    _sets.push_back(&s);
+}
+
+
+template <typename SetType>
+typename AVLMerge<SetType>::ConstIterator AVLMerge<SetType>::begin() const
+{
+    ConstIterator i;
+    i._heap.reserve(_sets.size());
+    for (const SetType* s : _sets)
+    {
+        if (s->begin() != s->end())
+        {
+            i._heap.push_back(typename ConstIterator::Cursor{s->begin(), s->end()});
+        }
+    }
+    std::make_heap(i._heap.begin(), i._heap.end(), ConstIterator::comesAfter);
+
+    return i;
+}
+
+
+template <typename SetType>
+typename AVLMerge<SetType>::ConstIterator AVLMerge<SetType>::end() const noexcept
+{
+    return ConstIterator{};
+}
+
+
+#endif
@@ -0,0 +1,234 @@
+// AVLMultiset.hpp
+//
+// An AVLMultiset is a set in which each element can appear more than once.
+// Rather than storing duplicates separately, each node of its AVL tree (see
+// AVLTree.hpp) holds one distinct element along with the number of times it
+// appears, so adding an element that is already present just increments its
+// count.  Every node also keeps the total number of occurrences in its
+// subtree, an augmentation of the tree, so that order statistics such as
+// rank() and select() are weighted by those counts.  Every operation runs in
+// O(log n) time when there are n distinct elements.
+
+#ifndef AVLMULTISET_HPP
+#define AVLMULTISET_HPP
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include "AVLTree.hpp"
+
+
+template <typename ElementType>
+class AVLMultiset
+{
+public:
+    // A VisitFunction is a function that takes a reference to a const
+    // ElementType and the number of times it appears, and returns no value.
+    using VisitFunction = std::function<void(const ElementType&, std::size_t)>;
+
+public:
+    // Initializes an AVLMultiset to be empty, with or without balancing.
+    // AVLMultisets can be copied and moved in the same ways as AVLSets.
+    explicit AVLMultiset(bool shouldBalance = true);
+
+
+    // add() adds one occurrence of an element to the multiset.
+    void add(const ElementType& element);
+
+
+    // contains() returns true if the given element appears at least once in
+    // the multiset, false otherwise.
+    bool contains(const ElementType& element) const;
+
+
+    // count() returns the number of times the given element appears in the
+    // multiset.
+    std::size_t count(const ElementType& element) const;
+
+
+    // removeOne() removes one occurrence of an element from the multiset,
+    // returning true if it appeared at least once and false otherwise.
+    bool removeOne(const ElementType& element);
+
+
+    // removeAll() removes every occurrence of an element from the multiset,
+    // returning the number of occurrences that were removed.
+    std::size_t removeAll(const ElementType& element);
+
+
+    // size() returns the number of elements in the multiset, counting each
+    // occurrence separately.
+    std::size_t size() const noexcept;
+
+
+    // distinctSize() returns the number of distinct elements in the multiset.
+    std::size_t distinctSize() const noexcept;
+
+
+    // rank() returns the number of occurrences of elements that are less
+    // than the given one, which is the position the element's first
+    // occurrence has (or would have) in ascending order.
+    std::size_t rank(const ElementType& element) const;
+
+
+    // select() returns a pointer to the element at the given position in
+    // ascending order, counting each occurrence separately, or nullptr if
+    // there are not that many occurrences.  Positions start at 0.
+    const ElementType* select(std::size_t position) const;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const noexcept;
+
+
+    // inorder() calls the given "visit" function once for each distinct
+    // element, along with the number of times it appears, in ascending order.
+    void inorder(VisitFunction visit) const;
+
+
+private:
+    // Each node's aggregate is the number of occurrences in its subtree.
+    struct OccurrenceCount
+    {
+        using AggregateType = std::size_t;
+
+        static AggregateType identity() noexcept
+        {
+            return 0;
+        }
+
+        static AggregateType of(const std::pair<const ElementType, std::size_t>& p) noexcept
+        {
+            return p.second;
+        }
+
+        static AggregateType combine(AggregateType a, AggregateType b) noexcept
+        {
+            return a + b;
+        }
+    };
+
+    AVLTree<ElementType, std::pair<const ElementType, std::size_t>, AVLPairKey, OccurrenceCount> _tree;
+    std::size_t _sz;
+};
+
+
+template <typename ElementType>
+AVLMultiset<ElementType>::AVLMultiset(bool shouldBalance)
+    : _tree{shouldBalance}, _sz{0}
+{
+}
+
+
+template <typename ElementType>
+void AVLMultiset<ElementType>::add(const ElementType& element)
+{
+    // An element that is already present is counted in the node that
+    // emplace() found, without searching for it again.
+    auto result = _tree.emplace(element, element, std::size_t{1});
+    if (!result.second)
+    {
+        _tree.modify(result.first, [](std::pair<const ElementType, std::size_t>& p) { ++p.second; });
+    }
+    ++_sz;
+}
+
+
+template <typename ElementType>
+bool AVLMultiset<ElementType>::contains(const ElementType& element) const
+{
+    return _tree.find(element) != nullptr;
+}
+
+
+template <typename ElementType>
+std::size_t AVLMultiset<ElementType>::count(const ElementType& element) const
+{
+    auto node = _tree.find(element);
+    return node == nullptr ? 0 : node->value.second;
+}
+
+
+template <typename ElementType>
+bool AVLMultiset<ElementType>::removeOne(const ElementType& element)
+{
+    auto node = _tree.find(element);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    if (node->value.second > 1)
+    {
+        _tree.modify(node, [](std::pair<const ElementType, std::size_t>& p) { --p.second; });
+    } else
+    {
+        _tree.erase(node);
+    }
+    --_sz;
+    return true;
+}
+
+
+template <typename ElementType>
+std::size_t AVLMultiset<ElementType>::removeAll(const ElementType& element)
+{
+    auto node = _tree.find(element);
+    if (node == nullptr)
+    {
+        return 0;
+    }
+
+    std::size_t removed = node->value.second;
+    _tree.erase(node);
+    _sz -= removed;
+    return removed;
+}
+
+
+template <typename ElementType>
+std::size_t AVLMultiset<ElementType>::size() const noexcept
+{
+    return _sz;
+}
+
+
+template <typename ElementType>
+std::size_t AVLMultiset<ElementType>::distinctSize() const noexcept
+{
+    return _tree.size();
+}
+
+
+template <typename ElementType>
+std::size_t AVLMultiset<ElementType>::rank(const ElementType& element) const
+{
+    return _tree.aggregate(nullptr, &element);
+}
+
+
+template <typename ElementType>
+const ElementType* AVLMultiset<ElementType>::select(std::size_t position) const
+{
+    auto node = _tree.findFirst([&](std::size_t occurrences) { return occurrences > position; });
+    return node == nullptr ? nullptr : &node->value.first;
+}
+
+
+template <typename ElementType>
+int AVLMultiset<ElementType>::height() const noexcept
+{
+    return _tree.height();
+}
+
+
+template <typename ElementType>
+void AVLMultiset<ElementType>::inorder(VisitFunction visit) const
+{
+    _tree.inorder(
+        [&](const std::pair<const ElementType, std::size_t>& p) { visit(p.first, p.second); });
+}
+
+
+#endif
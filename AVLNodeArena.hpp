@@ -0,0 +1,150 @@
+// AVLNodeArena.hpp
+//
+// An AVLNodeArena hands out fixed-size blocks of memory for the nodes of AVL
+// trees, carved from 2MB chunks that are backed by huge pages wherever the
+// system allows it.  In a tree of many millions of nodes, each descent
+// touches nodes scattered across gigabytes of memory, and with ordinary 4KB
+// pages nearly every one of those touches also misses in the TLB.  With 2MB
+// pages, the TLB covers 512 times as much memory, so most of those misses
+// go away.
+//
+// On Linux, each chunk is mapped anonymously, aligned to 2MB and marked with
+// madvise(MADV_HUGEPAGE), which asks for transparent huge pages even when
+// they are only enabled on request.  Defining AVLTREE_HUGETLB asks for
+// explicit hugetlbfs pages (MAP_HUGETLB) first, falling back to transparent
+// ones if none are reserved.  On other systems, chunks come from operator
+// new and are backed however the system sees fit.
+//
+// There is one arena per size and alignment of node, shared by every tree
+// whose nodes have that size and alignment, and by every thread.  Blocks
+// that are freed are reused for later nodes, but chunks are never returned
+// to the system.
+//
+// An AVLTree allocates its nodes from an AVLNodeArena when
+// AVLTREE_HUGE_PAGE_ARENA is defined before including AVLTree.hpp.
+
+#ifndef AVLNODEARENA_HPP
+#define AVLNODEARENA_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+
+template <std::size_t BlockSize, std::size_t BlockAlignment>
+class AVLNodeArena
+{
+public:
+    // allocate() returns a block of BlockSize bytes, aligned to
+    // BlockAlignment, throwing std::bad_alloc if there is no memory left.
+    static void* allocate();
+
+
+    // deallocate() returns a block that was allocated from the arena, so
+    // that it can be used again.
+    static void deallocate(void* block) noexcept;
+
+
+private:
+    static constexpr std::size_t ChunkSize = std::size_t{2} << 20;
+
+    // Every block is big enough and aligned well enough to hold a FreeBlock,
+    // which links it into the list of free blocks while it isn't in use.
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static constexpr std::size_t Alignment =
+        BlockAlignment > alignof(FreeBlock) ? BlockAlignment : alignof(FreeBlock);
+
+    static constexpr std::size_t Stride =
+        ((BlockSize > sizeof(FreeBlock) ? BlockSize : sizeof(FreeBlock)) + Alignment - 1) / Alignment * Alignment;
+
+    static_assert(Stride <= ChunkSize, "AVLNodeArena blocks must fit in a chunk");
+
+    inline static std::mutex _lock;
+    inline static FreeBlock* _free = nullptr;
+    inline static char* _next = nullptr;
+    inline static char* _end = nullptr;
+
+    static char* allocateChunk();
+};
+
+
+template <std::size_t BlockSize, std::size_t BlockAlignment>
+char* AVLNodeArena<BlockSize, BlockAlignment>::allocateChunk()
+{
+#ifdef __linux__
+#ifdef AVLTREE_HUGETLB
+    void* huge = mmap(nullptr, ChunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (huge != MAP_FAILED)
+    {
+        return static_cast<char*>(huge);
+    }
+#endif
+
+    // Huge pages must be aligned to their size, so map twice as much as is
+    // needed and unmap whatever lies outside the aligned chunk.
+    void* mapped = mmap(nullptr, 2 * ChunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::bad_alloc{};
+    }
+
+    char* start = static_cast<char*>(mapped);
+    char* chunk = reinterpret_cast<char*>(
+        (reinterpret_cast<std::size_t>(start) + ChunkSize - 1) & ~(ChunkSize - 1));
+    if (chunk != start)
+    {
+        munmap(start, chunk - start);
+    }
+    munmap(chunk + ChunkSize, start + 2 * ChunkSize - (chunk + ChunkSize));
+
+    madvise(chunk, ChunkSize, MADV_HUGEPAGE);
+    return chunk;
+#else
+    return static_cast<char*>(::operator new(ChunkSize, std::align_val_t{ChunkSize}));
+#endif
+}
+
+
+template <std::size_t BlockSize, std::size_t BlockAlignment>
+void* AVLNodeArena<BlockSize, BlockAlignment>::allocate()
+{
+    std::lock_guard<std::mutex> lock{_lock};
+
+    if (_free != nullptr)
+    {
+        FreeBlock* block = _free;
+        _free = block->next;
+        return block;
+    }
+
+    if (_end - _next < static_cast<std::ptrdiff_t>(Stride))
+    {
+        _next = allocateChunk();
+        _end = _next + ChunkSize;
+    }
+
+    void* block = _next;
+    _next += Stride;
+    return block;
+}
+
+
+template <std::size_t BlockSize, std::size_t BlockAlignment>
+void AVLNodeArena<BlockSize, BlockAlignment>::deallocate(void* block) noexcept
+{
+    std::lock_guard<std::mutex> lock{_lock};
+
+    FreeBlock* freed = ::new (block) FreeBlock{_free};
+    _free = freed;
+}
+
+
+#endif
@@ -16,24 +16,32 @@
 // in your data structure.  Instead, you'll need to implement your AVL tree
 // using your own dynamically-allocated nodes, with pointers connecting them,
 // and with your own balancing algorithms used.
+//
+// The AVL tree itself is an AVLTree (see AVLTree.hpp), the engine that is
+// also shared by AVLMap.  An AVLSet can optionally be given an Augmentation,
+// such as those in AVLAugmentations.hpp, so that it can answer aggregate
+// queries over ranges of elements in O(log n) time.
 
 #ifndef AVLSET_HPP
 #define AVLSET_HPP
 
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "Set.hpp"
+#include "AVLTree.hpp"
+#include "AVLAugmentations.hpp"
 #include <algorithm>
 #include <iostream>
 #include <cmath>
 
 
-namespace
-{
-    enum Rotation {LL, LR, RL, RR};
-}
-
-
-template <typename ElementType>
+template <typename ElementType, typename Augmentation = AVLNoAugmentation>
 class AVLSet : public Set<ElementType>
 {
 public:
@@ -41,6 +49,23 @@ public:
     // ElementType and returns no value.
     using VisitFunction = std::function<void(const ElementType&)>;
 
+    // An AggregateType is what the Augmentation computes over the elements
+    // in a range; it is void if the set is not augmented.
+    using AggregateType = typename Augmentation::AggregateType;
+
+    // A ConstIterator visits the elements in ascending order.  It remains
+    // valid until the element it refers to is removed.
+    using ConstIterator = typename AVLTree<ElementType, ElementType, AVLIdentityKey, Augmentation>::ConstIterator;
+
+    // A NodeHandle owns an element that has been extracted from an AVLSet,
+    // along with the node it was stored in, so that it can be inserted into
+    // another AVLSet of the same type without allocating or copying.
+    using NodeHandle = typename AVLTree<ElementType, ElementType, AVLIdentityKey, Augmentation>::NodeHandle;
+
+    // A ConstRange is the part of an AVLSet between two of its iterators,
+    // which, under C++20, is a view.
+    using ConstRange = typename AVLTree<ElementType, ElementType, AVLIdentityKey, Augmentation>::ConstRange;
+
 public:
     // Initializes an AVLSet to be empty, with or without balancing.
     explicit AVLSet(bool shouldBalance = true);
@@ -73,21 +98,154 @@ public:
     void add(const ElementType& element) override;
 
 
+    // remove() removes an element from the set, returning true if it was in
+    // the set and false otherwise.  This function always runs in O(log n)
+    // time when there are n elements in the AVL tree.
+    bool remove(const ElementType& element);
+
+
+    // erase() removes the element that the given iterator refers to, which
+    // must not be end(), without searching for it, and returns an iterator
+    // to the element after it.
+    ConstIterator erase(ConstIterator position);
+
+
+    // extract() removes the element that the given iterator refers to, which
+    // must not be end(), and returns a NodeHandle that owns it.
+    NodeHandle extract(ConstIterator position);
+
+
+    // extract() removes the given element, if it is in the set, and returns
+    // a NodeHandle that owns it, which is empty if it was not in the set.
+    NodeHandle extract(const ElementType& element);
+
+
+    // insert() adds the element owned by the given NodeHandle to the set,
+    // without allocating or copying, and returns true.  If the handle is
+    // empty, or its element is already in the set, the set is not changed,
+    // the handle keeps its element and insert() returns false.
+    bool insert(NodeHandle&& handle);
+
+
     // contains() returns true if the given element is already in the set,
     // false otherwise.  This function always runs in O(log n) time when
     // there are n elements in the AVL tree.
     bool contains(const ElementType& element) const override;
 
 
-    // size() returns the number of elements in the set.
+    // operator==() returns true if both sets have the same elements, and
+    // operator!=() returns true if they don't.  isSubsetOf() returns true if
+    // every element of this set is also in the given one, and isDisjoint()
+    // returns true if no element is in both.  Each walks through both sets
+    // in order at once, so it runs in O(n + m) time when the sets have n
+    // and m elements, and a set is compared with itself in O(1) time.
+    bool operator==(const AVLSet& s) const;
+
+    bool operator!=(const AVLSet& s) const;
+
+    bool isSubsetOf(const AVLSet& s) const;
+
+    bool isDisjoint(const AVLSet& s) const;
+
+
+    // find() returns an iterator to the given element, or end() if it is
+    // not in the set.  This function always runs in O(log n) time when there
+    // are n elements in the AVL tree.
+    ConstIterator find(const ElementType& element) const;
+
+
+    // begin() and end() return iterators to the smallest element and just
+    // past the largest one.  Stepping through all n elements takes O(n)
+    // time in total.
+    ConstIterator begin() const noexcept;
+
+    ConstIterator end() const noexcept;
+
+
+    // lowerBound() returns an iterator to the smallest element that is not
+    // less than the given one, or end() if there is none.  This function
+    // always runs in O(log n) time.
+    ConstIterator lowerBound(const ElementType& element) const;
+
+
+    // range() returns the elements that are at least lo and less than hi,
+    // as a ConstRange.  Finding where the range begins and ends takes
+    // O(log n) time; nothing else is touched until the range is iterated,
+    // so a pipeline such as
+    //
+    //     s.range(lo, hi) | std::views::filter(f) | std::views::take(k)
+    //
+    // visits only the elements it needs.
+    ConstRange range(const ElementType& lo, const ElementType& hi) const;
+
+
+    // size() returns the number of elements in the set, or the largest
+    // unsigned int if there are more elements than that; size64() always
+    // returns the number of elements.
     unsigned int size() const noexcept override;
 
+    std::size_t size64() const noexcept;
+
 
     // height() returns the height of the AVL tree.  Note that, by definition,
     // the height of an empty tree is -1.
     int height() const noexcept;
 
 
+    // aggregate() returns the aggregate of all of the elements in the set.
+    // Only augmented sets have aggregates.
+    AggregateType aggregate() const;
+
+
+    // aggregate() returns the aggregate of the elements that are at least lo
+    // and less than hi.  This function always runs in O(log n) time when
+    // there are n elements in the AVL tree.
+    AggregateType aggregate(const ElementType& lo, const ElementType& hi) const;
+
+
+    // aggregateBelow() returns the aggregate of the elements that are less
+    // than hi.  This function always runs in O(log n) time.
+    AggregateType aggregateBelow(const ElementType& hi) const;
+
+
+    // findFirst() returns a pointer to the smallest element for which
+    // "predicate" returns true when passed the aggregate of that element and
+    // every smaller one, or nullptr if there is none.  The predicate must be
+    // monotonic: once true for an element, it must be true for every larger
+    // one.  This function always runs in O(log n) time.
+    template <typename Predicate>
+    const ElementType* findFirst(Predicate predicate) const;
+
+
+    // differences() calls the given "visit" function with each element that
+    // is in only one of this set and s, along with true if that's this set
+    // and false if it's s.  Both sets must be augmented with an
+    // AVLHashAugmentation, whose aggregate() is a fingerprint of a set's
+    // contents, so that ranges with the same fingerprint in both can be
+    // skipped.  This function runs in O(d log n log m) time when there are d
+    // such elements, and sets with n and m elements.
+    template <typename DifferenceFunction>
+    void differences(const AVLSet& s, DifferenceFunction visit) const;
+
+
+    // copyTo() copies the elements in the set, in ascending order, to the
+    // given output iterator, and returns an iterator just past the last
+    // element copied.  It runs in O(n) time, without the cost of calling a
+    // VisitFunction for each element.
+    template <typename OutputIterator>
+    OutputIterator copyTo(OutputIterator out) const;
+
+
+    // toSortedArray() returns the elements in the set, in ascending order,
+    // in a vector that is allocated once, at its final size.  If the set is
+    // augmented with AVLCountAugmentation and more than one thread is asked
+    // for, the vector is split into that many parts, each filled by its own
+    // thread, which finds where its part starts in O(log n) time.  Otherwise
+    // it is filled by the calling thread.  A parallel fill requires
+    // ElementType to be default-constructible.
+    std::vector<ElementType> toSortedArray(unsigned int threads = 1) const;
+
+
     // preorder() calls the given "visit" function for each of the elements
     // in the set, in the order determined by a preorder traversal of the AVL
     // tree.
@@ -107,418 +265,341 @@ public:
 
 
 private:
-    struct Node
-    {
-        Node* left;
-        Node* right;
-        ElementType value;
-        int height;
-    };
+    AVLTree<ElementType, ElementType, AVLIdentityKey, Augmentation> _tree;
+};
 
-    Node* _root;
-    int _sz;
-    bool _shouldBalance;
 
-    void updateDepth(int depth);
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>::AVLSet(bool shouldBalance)
+    : _tree{shouldBalance}
+{
+}
 
-    void preorderR(VisitFunction visit, Node* t) const;
 
-    void postorderR(VisitFunction visit, Node* t) const;
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>::~AVLSet() noexcept
+{
+}
 
-    void inorderR(VisitFunction visit, Node* t) const;
 
-    void deleteTree(Node* t) noexcept;
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>::AVLSet(const AVLSet& s)
+    : _tree{s._tree}
+{
+}
 
-    Node* copyTree(Node* t);
 
-    Node* addR(Node* t, const ElementType& element, bool& exists);
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>::AVLSet(AVLSet&& s) noexcept
+    : _tree{std::move(s._tree)}
+{
+}
 
-    int getHeight(Node* t) const;
 
-    Rotation getNeededRotation(Node* t, const ElementType& element);
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>& AVLSet<ElementType, Augmentation>::operator=(const AVLSet& s)
+{
+    _tree = s._tree;
 
-    Node* rotate(Node* t, Rotation r);
+    return *this;
+}
 
-    Node* rotLL(Node* t);
-    
-    Node* rotLR(Node* t);
 
-    Node* rotRL(Node* t);
+template <typename ElementType, typename Augmentation>
+AVLSet<ElementType, Augmentation>& AVLSet<ElementType, Augmentation>::operator=(AVLSet&& s) noexcept
+{
+    _tree = std::move(s._tree);
 
-    Node* rotRR(Node* t);
-};
+    return *this;
+}
 
 
-template <typename ElementType>
-AVLSet<ElementType>::AVLSet(bool shouldBalance)
-    : _root{nullptr}, _sz{0}, _shouldBalance{shouldBalance}
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::isImplemented() const noexcept
 {
+    return true;
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::deleteTree(Node* t) noexcept
+template <typename ElementType, typename Augmentation>
+void AVLSet<ElementType, Augmentation>::add(const ElementType& element)
 {
-    if (t == nullptr)
-    {
-        return;
-    }
-    if (t->left != nullptr)
-    {
-        deleteTree(t->left); 
-    }
-    if (t->right != nullptr)
-    {
-        deleteTree(t->right); 
-    }
-    delete t;
+    _tree.emplace(element, element);
 }
 
 
-template <typename ElementType>
-AVLSet<ElementType>::~AVLSet() noexcept
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::remove(const ElementType& element)
 {
-    deleteTree(_root); 
+    return _tree.erase(element);
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::copyTree(Node* t)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstIterator AVLSet<ElementType, Augmentation>::erase(ConstIterator position)
 {
-    if (t == nullptr)
-    {
-        return nullptr;
-    }
+    return _tree.erase(position);
+}
 
-    Node* copy = new Node{nullptr, nullptr, t->value, t->height};
-    copy->left = copyTree(t->left);
-    copy->right = copyTree(t->right);
 
-    return copy;
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::NodeHandle AVLSet<ElementType, Augmentation>::extract(ConstIterator position)
+{
+    return _tree.extract(position);
 }
 
 
-template <typename ElementType>
-AVLSet<ElementType>::AVLSet(const AVLSet& s)
-    :_sz{s._sz}, _shouldBalance{s._shouldBalance}
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::NodeHandle AVLSet<ElementType, Augmentation>::extract(const ElementType& element)
 {
-    _root = copyTree(s._root); 
+    ConstIterator position = find(element);
+    return position == end() ? NodeHandle{} : extract(position);
 }
 
 
-template <typename ElementType>
-AVLSet<ElementType>::AVLSet(AVLSet&& s) noexcept
-    :_root{nullptr}, _sz{0}, _shouldBalance{false}
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::insert(NodeHandle&& handle)
 {
-    std::swap(_root, s._root);
-    std::swap(_sz, s._sz);
-    std::swap(_shouldBalance, s._shouldBalance);
+    return _tree.insert(std::move(handle)).second;
 }
 
 
-template <typename ElementType>
-AVLSet<ElementType>& AVLSet<ElementType>::operator=(const AVLSet& s)
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::contains(const ElementType& element) const
 {
-    deleteTree(_root);
-    _sz = s._sz;
-    _shouldBalance = s._shouldBalance;
-    _root = copyTree(s._root);
-
-    return *this;
+    return _tree.find(element) != nullptr;
 }
 
 
-template <typename ElementType>
-AVLSet<ElementType>& AVLSet<ElementType>::operator=(AVLSet&& s) noexcept
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::operator==(const AVLSet& s) const
 {
-    std::swap(_root, s._root);
-    std::swap(_sz, s._sz);
-    std::swap(_shouldBalance, s._shouldBalance);
-
-    return *this;
+    if (this == &s)
+    {
+        return true;
+    }
+    if (_tree.size() != s._tree.size())
+    {
+        return false;
+    }
+    return std::equal(begin(), end(), s.begin());
 }
 
 
-template <typename ElementType>
-bool AVLSet<ElementType>::isImplemented() const noexcept
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::operator!=(const AVLSet& s) const
 {
-    return true;
+    return !(*this == s);
 }
 
 
-template <typename ElementType>
-int AVLSet<ElementType>::getHeight(Node* t) const
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::isSubsetOf(const AVLSet& s) const
 {
-    if (t == nullptr)
+    if (this == &s)
+    {
+        return true;
+    }
+    if (_tree.size() > s._tree.size())
     {
-        return -1;
+        return false;
     }
-    return t->height;
+    return std::includes(s.begin(), s.end(), begin(), end());
 }
 
 
-template <typename ElementType>
-Rotation AVLSet<ElementType>::getNeededRotation(Node* t, const ElementType& element)
+template <typename ElementType, typename Augmentation>
+bool AVLSet<ElementType, Augmentation>::isDisjoint(const AVLSet& s) const
 {
-    if (element < t->value)
+    if (this == &s)
     {
-        if (element < t->left->value)
-        {
-            return Rotation::LL;
-        }
-        return Rotation::LR;
+        return _tree.size() == 0;
     }
-    if (element < t->right->value)
+
+    ConstIterator i = begin();
+    ConstIterator j = s.begin();
+    while (i != end() && j != s.end())
     {
-        return Rotation::RL;
+        if (*i < *j)
+        {
+            ++i;
+        } else if (*j < *i)
+        {
+            ++j;
+        } else
+        {
+            return false;
+        }
     }
-    return Rotation::RR;
+    return true;
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::rotLL(Node* t)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstIterator AVLSet<ElementType, Augmentation>::find(const ElementType& element) const
 {
-    Node* a = t->left;
-    Node* t2 = a->right;
-
-    t->left = t2; 
-    a->right = t;
-
-    t->height = 1 + std::max(getHeight(t2) , getHeight(t->right));     
-    a->height = 1 + std::max(getHeight(a->left), getHeight(t));
-
-    return a; 
+    return _tree.iteratorTo(_tree.find(element));
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::rotLR(Node* t)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstIterator AVLSet<ElementType, Augmentation>::begin() const noexcept
 {
-    Node* a = t->left; 
-    Node* b = a->right;
-    Node* t2 = b->left;
-    Node* t3 = b->right;
-
-    a->right = t2;
-    t->left = t3;
-    b->left = a;
-    b->right = t;
-
-    a->height = 1 + std::max(getHeight(a->left), getHeight(t2));
-    t->height = 1 + std::max(getHeight(t3), getHeight(t->right));
-    b->height = 1 + std::max(getHeight(a), getHeight(t));
-
-    return b;
+    return _tree.begin();
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::rotRL(Node* t)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstIterator AVLSet<ElementType, Augmentation>::end() const noexcept
 {
-    Node* c = t->right;
-    Node* b = c->left;
-    Node* t2 = b->left;
-    Node* t3 = b->right;
-
-    t->right = t2;
-    c->left = t3;
-    b->left = t;
-    b->right = c;
-
-    t->height = 1 + std::max(getHeight(t->left), getHeight(t2));
-    c->height = 1 + std::max(getHeight(t3), getHeight(c->right));
-    b->height = 1 + std::max(getHeight(t), getHeight(c));
-
-    return b;
+    return _tree.end();
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::rotRR(Node* t)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstIterator AVLSet<ElementType, Augmentation>::lowerBound(const ElementType& element) const
 {
-    Node* b = t->right;
-    Node* t2 = b->left; 
-
-    t->right = t2;
-    b->left = t;
-
-    t->height = 1 + std::max(getHeight(t->left), getHeight(t2));
-    b->height = 1 + std::max(getHeight(t), getHeight(b->right));
-
-    return b;
+    return _tree.iteratorTo(_tree.lowerBound(element));
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::rotate(Node* t, Rotation r)
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::ConstRange AVLSet<ElementType, Augmentation>::range(const ElementType& lo, const ElementType& hi) const
 {
-    if (r == Rotation::LL)
-    {
-        return rotLL(t);
-    } else if (r == Rotation::LR)
-    {
-        return rotLR(t);
-    } else if (r == Rotation::RL)
+    if (!(lo < hi))
     {
-        return rotRL(t);
-    } else
-    {
-        return rotRR(t);
+        return ConstRange{end(), end()};
     }
+    return ConstRange{lowerBound(lo), lowerBound(hi)};
 }
 
 
-template <typename ElementType>
-typename AVLSet<ElementType>::Node* AVLSet<ElementType>::addR(Node* t, const ElementType& element,
-    bool& exists)
+template <typename ElementType, typename Augmentation>
+unsigned int AVLSet<ElementType, Augmentation>::size() const noexcept
 {
-    if(t == nullptr)
-    {
-        return new Node{nullptr, nullptr, element, 0};
-    }
-    if (t->value == element)
-    {
-        exists = true;
-        return t;
-    }
-    if (element < t->value)
-    {
-        t->left = addR(t->left, element, exists);
-    } else
-    {
-        t->right = addR(t->right, element, exists);
-    }
-    if (!exists)
-    {
-        int newHeight = 1 + std::max(getHeight(t->left), getHeight(t->right));
-        if (newHeight > t->height)
-        {
-            t->height += 1; 
-        }
+    return static_cast<unsigned int>(
+        std::min<std::size_t>(size64(), std::numeric_limits<unsigned int>::max()));
+}
 
-        if (abs(getHeight(t->left) - getHeight(t->right)) > 1 && _shouldBalance)
-        {
-            Rotation r = getNeededRotation(t, element); 
-            t = rotate(t, r);
-        }
-    }
-    
-    return t;
+
+template <typename ElementType, typename Augmentation>
+std::size_t AVLSet<ElementType, Augmentation>::size64() const noexcept
+{
+    return _tree.size();
 }
 
-template <typename ElementType>
-void AVLSet<ElementType>::add(const ElementType& element)
+
+template <typename ElementType, typename Augmentation>
+int AVLSet<ElementType, Augmentation>::height() const noexcept
 {
-    bool exists = false;
-    _root = addR(_root, element, exists); 
-    
-    if (!exists)
-    {
-        ++_sz;
-    }
+    return _tree.height();
 }
 
 
-template <typename ElementType>
-bool AVLSet<ElementType>::contains(const ElementType& element) const
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::AggregateType AVLSet<ElementType, Augmentation>::aggregate() const
 {
-    Node* cur = _root; 
-    while (cur != nullptr)
-    {
-        if (cur->value == element)
-        {
-            return true;
-        }
-        if (element > cur->value)
-        {
-            cur = cur->right;
-        } else
-        {
-            cur = cur->left;
-        }
-    }
-    return false;
+    return _tree.aggregate(nullptr, nullptr);
 }
 
 
-template <typename ElementType>
-unsigned int AVLSet<ElementType>::size() const noexcept
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::AggregateType AVLSet<ElementType, Augmentation>::aggregate(
+    const ElementType& lo, const ElementType& hi) const
 {
-    return _sz;
+    return _tree.aggregate(&lo, &hi);
 }
 
 
-template <typename ElementType>
-int AVLSet<ElementType>::height() const noexcept
+template <typename ElementType, typename Augmentation>
+typename AVLSet<ElementType, Augmentation>::AggregateType AVLSet<ElementType, Augmentation>::aggregateBelow(
+    const ElementType& hi) const
 {
-    return getHeight(_root);
+    return _tree.aggregate(nullptr, &hi);
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::preorderR(VisitFunction visit, Node* t) const
+template <typename ElementType, typename Augmentation>
+template <typename DifferenceFunction>
+void AVLSet<ElementType, Augmentation>::differences(const AVLSet& s, DifferenceFunction visit) const
 {
-    visit(t->value);
+    _tree.differences(s._tree, visit);
+}
 
-    if (t->left != nullptr)
-    {
-        preorderR(visit, t->left);
-    }
-    if (t->right != nullptr)
-    {
-        preorderR(visit, t->right);
-    }
+
+template <typename ElementType, typename Augmentation>
+template <typename Predicate>
+const ElementType* AVLSet<ElementType, Augmentation>::findFirst(Predicate predicate) const
+{
+    auto node = _tree.findFirst(predicate);
+    return node == nullptr ? nullptr : &node->value;
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::preorder(VisitFunction visit) const
+template <typename ElementType, typename Augmentation>
+template <typename OutputIterator>
+OutputIterator AVLSet<ElementType, Augmentation>::copyTo(OutputIterator out) const
 {
-    preorderR(visit, _root);
+    return _tree.copyTo(_tree.first(), _tree.size(), out);
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::inorderR(VisitFunction visit, Node* t) const
+template <typename ElementType, typename Augmentation>
+std::vector<ElementType> AVLSet<ElementType, Augmentation>::toSortedArray(unsigned int threads) const
 {
-    if (t != nullptr)
+    std::size_t n = size64();
+
+    if constexpr (std::is_same_v<Augmentation, AVLCountAugmentation> && std::is_default_constructible_v<ElementType>)
     {
-        inorderR(visit, t->left);
-        visit(t->value);
-        inorderR(visit, t->right);
+        if (threads > 1 && n >= threads)
+        {
+            std::vector<ElementType> elements(n);
+            std::vector<std::thread> fillers;
+            for (unsigned int i = 0; i < threads; ++i)
+            {
+                std::size_t first = n * i / threads;
+                std::size_t last = n * (i + 1) / threads;
+                fillers.emplace_back(
+                    [this, &elements, first, last]
+                    {
+                        auto start = _tree.findFirst([first](std::size_t count) { return count > first; });
+                        _tree.copyTo(start, last - first, elements.begin() + first);
+                    });
+            }
+            for (std::thread& filler : fillers)
+            {
+                filler.join();
+            }
+            return elements;
+        }
     }
+
+    std::vector<ElementType> elements;
+    elements.reserve(n);
+    copyTo(std::back_inserter(elements));
+    return elements;
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::inorder(VisitFunction visit) const
-{ 
-    inorderR(visit, _root);
+template <typename ElementType, typename Augmentation>
+void AVLSet<ElementType, Augmentation>::preorder(VisitFunction visit) const
+{
+    _tree.preorder(visit);
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::postorderR(VisitFunction visit, Node* t) const
+template <typename ElementType, typename Augmentation>
+void AVLSet<ElementType, Augmentation>::inorder(VisitFunction visit) const
 {
-    if (t->left != nullptr)
-    {
-        postorderR(visit, t->left);
-    }
-    if (t->right != nullptr)
-    {
-        postorderR(visit, t->right);
-    }
-    visit(t->value);
+    _tree.inorder(visit);
 }
 
 
-template <typename ElementType>
-void AVLSet<ElementType>::postorder(VisitFunction visit) const
+template <typename ElementType, typename Augmentation>
+void AVLSet<ElementType, Augmentation>::postorder(VisitFunction visit) const
 {
-    postorderR(visit, _root);
+    _tree.postorder(visit);
 }
 
 
 #endif
-
@@ -0,0 +1,1418 @@
+// AVLTree.hpp
+//
+// An AVLTree is the engine shared by AVLSet and AVLMap.  It stores one
+// ValueType per node and orders the nodes by a key that KeyOfValue extracts
+// from each value: for an AVLSet the value is its own key, while for an
+// AVLMap the value is a key/value pair and the key is its first half.  That
+// way a map keeps its keys and values in the same node, and finding either
+// takes a single descent.
+//
+// Like an AVLSet, an AVLTree can be asked not to balance itself, in which
+// case it acts like a binary search tree.  Balance is restored after every
+// addition and every removal.
+//
+// Every node links to its parent as well as its children.  That lets a
+// node be used as a handle: the next and previous nodes in order can be
+// found from it in O(1) amortized time, without a stack, and it can be
+// removed without searching for it again.  It also lets additions and
+// removals retrace the path back up to the root in a loop, stopping as soon
+// as a subtree's height is unchanged, since nothing above it can then have
+// become unbalanced.
+//
+// Those links live in an AVLHook at the start of each node, and are kept
+// balanced by the same AVLHookAlgorithms that AVLIntrusiveSet uses (see
+// AVLHook.hpp).
+//
+// An AVLTree can also be augmented, so that each node keeps an aggregate of
+// all the values in its subtree.  An Augmentation is a monoid over those
+// values, which supplies:
+//
+//     using AggregateType = ...;
+//     static AggregateType identity();
+//     static AggregateType of(const ValueType& value);
+//     static AggregateType combine(const AggregateType& a, const AggregateType& b);
+//
+// where combine() must be associative and identity() must leave anything
+// unchanged when combined with it.  A node's aggregate is recomputed, from
+// its children's aggregates, whenever the node's subtree changes: on the
+// path of every addition and removal, and in the rotations.  That keeps the
+// cost of every update at O(log n), and lets the aggregate of any range of
+// keys be found in O(log n) time.  Order statistics, range sums and range
+// maximums are all augmentations (see AVLAugmentations.hpp).
+//
+// For some types of keys, each node also caches a prefix of its key inline,
+// so that most comparisons on the way down the tree can be settled without
+// following a pointer out of the node.  This is done for std::string keys,
+// whose characters otherwise live in a separate heap buffer, which would
+// mean a second cache miss at every level of the tree.
+//
+// Defining AVLTREE_BRANCHLESS_SEARCH before including this file makes find()
+// use a branchless descent for arithmetic keys; see find() for when that
+// helps.  Defining AVLTREE_HUGE_PAGE_ARENA makes every tree allocate its
+// nodes from an AVLNodeArena, backed by huge pages (see AVLNodeArena.hpp),
+// which helps once a tree is much larger than the TLB can cover.  Defining
+// AVLTREE_PREFETCH makes searches and inorder traversals prefetch nodes
+// before they are needed, which helps once a tree is much larger than the
+// cache.
+//
+// An AVLTree is not meant to be used directly; use AVLSet or AVLMap.
+
+#ifndef AVLTREE_HPP
+#define AVLTREE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "AVLHook.hpp"
+
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+
+#ifdef AVLTREE_HUGE_PAGE_ARENA
+#include "AVLNodeArena.hpp"
+#endif
+
+
+// The Augmentation for a tree that keeps no aggregates, which is the
+// default.  Its nodes have no room for an aggregate at all.
+struct AVLNoAugmentation
+{
+    using AggregateType = void;
+};
+
+
+// An AVLAggregateField is the part of a node that holds its aggregate, which
+// takes up no space in the nodes of a tree that keeps no aggregates.
+template <typename AggregateType>
+struct AVLAggregateField
+{
+    AggregateType aggregate;
+};
+
+
+template <>
+struct AVLAggregateField<void>
+{
+};
+
+
+// AVLKeyPrefix says which prefix, if any, of a KeyType is cached in each
+// node.  The PrefixType must order the same way as the keys it is taken
+// from whenever two prefixes differ; when they are equal, compare() decides.
+template <typename KeyType>
+struct AVLKeyPrefix
+{
+    using PrefixType = void;
+};
+
+
+// A std::string caches its first eight characters, packed into an integer
+// so that the first character is the most significant and shorter strings
+// are padded with zeroes.  Like std::string's own comparison, this compares
+// characters as unsigned values.
+template <>
+struct AVLKeyPrefix<std::string>
+{
+    using PrefixType = std::uint64_t;
+
+    static PrefixType of(const std::string& key) noexcept
+    {
+        PrefixType prefix = 0;
+        std::size_t length = std::min<std::size_t>(key.size(), sizeof(PrefixType));
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            prefix |= static_cast<PrefixType>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+        }
+        return prefix;
+    }
+
+    static int compare(const std::string& a, const std::string& b) noexcept
+    {
+        return a.compare(b);
+    }
+};
+
+
+// An AVLPrefixField is the part of a node that caches its key's prefix,
+// which takes up no space for keys that have no prefix cached.
+template <typename PrefixType>
+struct AVLPrefixField
+{
+    PrefixType prefix;
+};
+
+
+template <>
+struct AVLPrefixField<void>
+{
+};
+
+
+// The KeyOfValue for a tree whose values are their own keys.
+struct AVLIdentityKey
+{
+    template <typename ValueType>
+    static const ValueType& get(const ValueType& value) noexcept
+    {
+        return value;
+    }
+};
+
+
+// The KeyOfValue for a tree whose values are pairs keyed by their first half.
+struct AVLPairKey
+{
+    template <typename PairType>
+    static const typename PairType::first_type& get(const PairType& value) noexcept
+    {
+        return value.first;
+    }
+};
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue,
+    typename Augmentation = AVLNoAugmentation>
+class AVLTree
+{
+public:
+    using AggregateType = typename Augmentation::AggregateType;
+
+    static constexpr bool IsAugmented = !std::is_void_v<AggregateType>;
+
+    using PrefixType = typename AVLKeyPrefix<KeyType>::PrefixType;
+
+    static constexpr bool HasPrefix = !std::is_void_v<PrefixType>;
+
+    // A node's children are indexed by Direction, so that code that walks
+    // down or rearranges the tree can be written once, in terms of a
+    // direction, rather than once for each side.
+    enum Direction {Left = 0, Right = 1};
+
+    struct Node : AVLHook<>, AVLAggregateField<AggregateType>, AVLPrefixField<PrefixType>
+    {
+        ValueType value;
+
+#ifdef AVLTREE_HUGE_PAGE_ARENA
+        static void* operator new(std::size_t)
+        {
+            return AVLNodeArena<sizeof(Node), alignof(Node)>::allocate();
+        }
+
+        static void operator delete(void* t) noexcept
+        {
+            AVLNodeArena<sizeof(Node), alignof(Node)>::deallocate(t);
+        }
+#endif
+    };
+
+    // A ConstIterator visits the values in a tree in ascending order of their
+    // keys.  It remains valid until the node it refers to is removed, no
+    // matter what else is added to or removed from the tree.
+    class ConstIterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = ValueType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ValueType*;
+        using reference = const ValueType&;
+
+        ConstIterator() noexcept
+            : _tree{nullptr}, _node{nullptr}
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return _node->value;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &_node->value;
+        }
+
+        ConstIterator& operator++() noexcept
+        {
+            _node = next(_node);
+            return *this;
+        }
+
+        ConstIterator operator++(int) noexcept
+        {
+            ConstIterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        // Stepping back from the end of a tree reaches its last node.
+        ConstIterator& operator--() noexcept
+        {
+            _node = _node == nullptr ? _tree->last() : prev(_node);
+            return *this;
+        }
+
+        ConstIterator operator--(int) noexcept
+        {
+            ConstIterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const ConstIterator& i) const noexcept
+        {
+            return _node == i._node;
+        }
+
+        bool operator!=(const ConstIterator& i) const noexcept
+        {
+            return _node != i._node;
+        }
+
+    private:
+        friend class AVLTree;
+
+        ConstIterator(const AVLTree* tree, Node* node) noexcept
+            : _tree{tree}, _node{node}
+        {
+        }
+
+        const AVLTree* _tree;
+        Node* _node;
+    };
+
+    // A ConstRange is the part of a tree between two iterators.  Under C++20,
+    // it is a view, so it can be composed with the standard range adaptors
+    // without copying anything.
+    class ConstRange
+#if __cplusplus >= 202002L
+        : public std::ranges::view_interface<ConstRange>
+#endif
+    {
+    public:
+        ConstRange() noexcept = default;
+
+        ConstRange(ConstIterator first, ConstIterator last) noexcept
+            : _first{first}, _last{last}
+        {
+        }
+
+        ConstIterator begin() const noexcept
+        {
+            return _first;
+        }
+
+        ConstIterator end() const noexcept
+        {
+            return _last;
+        }
+
+    private:
+        ConstIterator _first;
+        ConstIterator _last;
+    };
+
+    // A NodeHandle owns a node that has been extracted from a tree, so that
+    // the node can be inserted into another tree of the same type without
+    // allocating a new node or copying its value.  A node that is never
+    // inserted anywhere is destroyed along with its NodeHandle.
+    class NodeHandle
+    {
+    public:
+        NodeHandle() noexcept
+            : _node{nullptr}
+        {
+        }
+
+        ~NodeHandle() noexcept
+        {
+            delete _node;
+        }
+
+        NodeHandle(NodeHandle&& h) noexcept
+            : _node{nullptr}
+        {
+            std::swap(_node, h._node);
+        }
+
+        NodeHandle& operator=(NodeHandle&& h) noexcept
+        {
+            std::swap(_node, h._node);
+            return *this;
+        }
+
+        bool empty() const noexcept
+        {
+            return _node == nullptr;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return _node != nullptr;
+        }
+
+        // value() returns the value in the node, which must not be empty.
+        const ValueType& value() const noexcept
+        {
+            return _node->value;
+        }
+
+    private:
+        friend class AVLTree;
+
+        explicit NodeHandle(Node* node) noexcept
+            : _node{node}
+        {
+        }
+
+        Node* _node;
+    };
+
+public:
+    // Initializes an AVLTree to be empty, with or without balancing.
+    explicit AVLTree(bool shouldBalance = true);
+
+    // Cleans up the AVLTree so that it leaks no memory.
+    ~AVLTree() noexcept;
+
+    // Initializes a new AVLTree to be a copy of an existing one.
+    AVLTree(const AVLTree& t);
+
+    // Initializes a new AVLTree whose contents are moved from an
+    // expiring one.
+    AVLTree(AVLTree&& t) noexcept;
+
+    // Assigns an existing AVLTree into another.
+    AVLTree& operator=(const AVLTree& t);
+
+    // Assigns an expiring AVLTree into another.
+    AVLTree& operator=(AVLTree&& t) noexcept;
+
+
+    // emplace() looks for the node with the given key, and if there isn't
+    // one, adds a node whose value is constructed from "args".  It returns
+    // the node that has the key, and whether it was just added.  This
+    // function always runs in O(log n) time when there are n nodes in the
+    // AVL tree.
+    template <typename... Args>
+    std::pair<Node*, bool> emplace(const KeyType& key, Args&&... args);
+
+
+    // erase() removes the node with the given key, if there is one, and
+    // returns true if a node was removed.  This function always runs in
+    // O(log n) time when there are n nodes in the AVL tree.
+    bool erase(const KeyType& key);
+
+
+    // erase() removes the given node, which must be in this tree, without
+    // searching for it.  The removal itself takes O(1) time; restoring
+    // balance afterward takes O(log n) time in the worst case.
+    void erase(Node* t);
+
+
+    // erase() removes the node that the given iterator refers to, which must
+    // not be the end of the tree, and returns an iterator to the node after
+    // it.
+    ConstIterator erase(ConstIterator position);
+
+
+    // extract() removes the node that the given iterator refers to, which
+    // must not be the end of the tree, and returns a NodeHandle that owns
+    // it.  Neither the node nor its value is copied or destroyed.
+    NodeHandle extract(ConstIterator position);
+
+
+    // insert() adds the node owned by the given NodeHandle to the tree,
+    // unless the handle is empty or the tree already has a node with the
+    // same key, in which case the handle keeps its node.  It returns an
+    // iterator to the node with the key, and whether the handle's node was
+    // added.  No node is allocated and no value is copied.
+    std::pair<ConstIterator, bool> insert(NodeHandle&& handle);
+
+
+    // find() returns the node with the given key, or nullptr if there isn't
+    // one.  This function always runs in O(log n) time when there are n
+    // nodes in the AVL tree.
+    Node* find(const KeyType& key) const;
+
+
+    // lowerBound() returns the first node whose key is not less than the
+    // given one, or nullptr if there isn't one.  This function always runs
+    // in O(log n) time.
+    Node* lowerBound(const KeyType& key) const;
+
+
+    // root() returns the root node, or nullptr if the tree is empty, for
+    // searches that need to prune subtrees by their aggregates.
+    const Node* root() const noexcept;
+
+
+    // childOf() and parentOf() return the given node's child in the given
+    // direction and its parent, or nullptr if there is no such node.
+    static Node* childOf(const Node* t, int dir) noexcept;
+
+    static Node* parentOf(const Node* t) noexcept;
+
+
+    // first() and last() return the nodes with the smallest and largest
+    // keys, or nullptr if the tree is empty.
+    Node* first() const noexcept;
+
+    Node* last() const noexcept;
+
+
+    // next() and prev() return the node that comes after or before the
+    // given one in ascending order of keys, or nullptr if there is none.
+    // Stepping through all n nodes this way takes O(n) time in total.
+    static Node* next(const Node* t) noexcept;
+
+    static Node* prev(const Node* t) noexcept;
+
+
+    // begin() and end() return iterators to the first node and just past the
+    // last one, and iteratorTo() returns one to the given node.
+    ConstIterator begin() const noexcept;
+
+    ConstIterator end() const noexcept;
+
+    ConstIterator iteratorTo(Node* t) const noexcept;
+
+
+    // modify() calls the given "modify" function with a reference to the
+    // value in the node with the given key, so that the value can be changed
+    // in place, and returns true if there is such a node.  If the tree is
+    // augmented, the aggregates that depend on the value are recomputed
+    // afterward.  "modify" must not change the value's key.
+    template <typename ModifyFunction>
+    bool modify(const KeyType& key, ModifyFunction&& modify);
+
+
+    // modify() does the same for the given node, without searching for it.
+    template <typename ModifyFunction>
+    void modify(Node* t, ModifyFunction&& modify);
+
+
+    // aggregate() returns the aggregate of the values whose keys are at least
+    // *lo and less than *hi, where a null pointer leaves that end of the range
+    // unbounded.  This function always runs in O(log n) time when there are n
+    // nodes in the AVL tree.  Only augmented trees have aggregates.
+    AggregateType aggregate(const KeyType* lo, const KeyType* hi) const;
+
+
+    // findFirst() returns the first node, in ascending order of keys, for
+    // which "predicate" returns true when passed the aggregate of that node's
+    // value and the values of every node before it, or nullptr if there is
+    // none.  The predicate must be monotonic: once true for a node, it must
+    // be true for every later node.  For example, with a count of nodes as
+    // the aggregate, the node for which that count first exceeds k is the one
+    // with k nodes before it.  This function always runs in O(log n) time.
+    template <typename Predicate>
+    Node* findFirst(Predicate&& predicate) const;
+
+
+    // differences() calls the given "visit" function with each value whose
+    // key is in only one of this tree and the other one, along with true if
+    // that's this tree and false if it's the other.  Ranges of keys whose
+    // aggregates are the same in both trees are assumed to hold the same
+    // values and are skipped, so the aggregates must be ones that tell apart
+    // different sets of values, such as those of an AVLHashAugmentation (see
+    // AVLAugmentations.hpp), and must not depend on the shape of the tree.
+    // Finding d differences takes O(d log n log m) time when the trees have
+    // n and m nodes, no matter how large they are otherwise.
+    template <typename DifferenceFunction>
+    void differences(const AVLTree& other, DifferenceFunction&& visit) const;
+
+
+    // size() returns the number of nodes in the tree.
+    std::size_t size() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const noexcept;
+
+
+    // preorder(), inorder() and postorder() call the given "visit" function
+    // with the value in each node, in the order determined by the respective
+    // traversal of the AVL tree.
+    template <typename VisitFunction>
+    void preorder(VisitFunction&& visit) const;
+
+    template <typename VisitFunction>
+    void inorder(VisitFunction&& visit) const;
+
+    template <typename VisitFunction>
+    void postorder(VisitFunction&& visit) const;
+
+
+    // copyTo() copies, in ascending order of keys, the values in the given
+    // node and the count - 1 nodes after it (or as many as there are) to
+    // the given output iterator, and returns an iterator just past the last
+    // value copied.  Finding where to start takes none of the time, so
+    // copying count values takes O(count + log n) time.
+    template <typename OutputIterator>
+    OutputIterator copyTo(const Node* t, std::size_t count, OutputIterator out) const;
+
+
+private:
+    // A Probe is a key being searched for, along with its prefix, which is
+    // computed once per search rather than once per level.
+    struct Probe : AVLPrefixField<PrefixType>
+    {
+        const KeyType& key;
+    };
+
+    // The balancing code, which is shared with every other tree of AVLHooks.
+    using Links = AVLHookAlgorithms<AVLHook<>>;
+
+    Node* _root;
+    std::size_t _sz;
+    bool _shouldBalance;
+
+    static const KeyType& keyOf(const Node* t) noexcept;
+
+    static Probe makeProbe(const KeyType& key);
+
+    static int compare(const Probe& probe, const Node* t);
+
+    static void prefetchChildren(const Node* t) noexcept;
+
+    static AggregateType aggregateOf(const Node* t);
+
+    AggregateType aggregateFromR(Node* t, const KeyType& lo) const;
+
+    AggregateType aggregateBelowR(Node* t, const KeyType& hi) const;
+
+    template <typename DifferenceFunction>
+    void differencesR(const AVLTree& other, const Node* t, const Node* lo, bool loShared, const Node* hi,
+        DifferenceFunction& visit) const;
+
+    static void updateNode(AVLHook<>* h);
+
+    template <typename VisitFunction>
+    void preorderR(VisitFunction& visit, Node* t) const;
+
+    template <typename VisitFunction>
+    void inorderR(VisitFunction& visit, Node* t) const;
+
+    template <typename VisitFunction>
+    void postorderR(VisitFunction& visit, Node* t) const;
+
+    template <typename OutputIterator>
+    void copyR(const Node* t, std::size_t& count, OutputIterator& out) const;
+
+    void deleteTree(Node* t) noexcept;
+
+    Node* copyTree(Node* t, Node* parent);
+
+    Node* locate(const Probe& probe, Node*& parent, int& dir) const;
+
+    void link(Node* t, Node* parent, int dir);
+
+    void unlink(Node* t);
+
+    void updateFrom(Node* t);
+};
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AVLTree(bool shouldBalance)
+    : _root{nullptr}, _sz{0}, _shouldBalance{shouldBalance}
+{
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+const KeyType& AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::keyOf(const Node* t) noexcept
+{
+    return KeyOfValue::get(t->value);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Probe
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::makeProbe(const KeyType& key)
+{
+    if constexpr (HasPrefix)
+    {
+        return Probe{{AVLKeyPrefix<KeyType>::of(key)}, key};
+    } else
+    {
+        return Probe{{}, key};
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+int AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::compare(const Probe& probe, const Node* t)
+{
+    if constexpr (HasPrefix)
+    {
+        if (probe.prefix != t->prefix)
+        {
+            return probe.prefix < t->prefix ? -1 : 1;
+        }
+        return AVLKeyPrefix<KeyType>::compare(probe.key, keyOf(t));
+    } else
+    {
+        if (keyOf(t) == probe.key)
+        {
+            return 0;
+        }
+        return probe.key < keyOf(t) ? -1 : 1;
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::prefetchChildren(const Node* t) noexcept
+{
+    // Which child a search moves to next isn't known until the comparison
+    // at t is done, but fetching both of them means that the one it needs
+    // is on its way while the comparison is being made.
+#if defined(AVLTREE_PREFETCH) && defined(__GNUC__)
+    __builtin_prefetch(t->child[Left]);
+    __builtin_prefetch(t->child[Right]);
+#else
+    static_cast<void>(t);
+#endif
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AggregateType
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::aggregateOf(const Node* t)
+{
+    if constexpr (IsAugmented)
+    {
+        if (t == nullptr)
+        {
+            return Augmentation::identity();
+        }
+        return t->aggregate;
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::updateNode(AVLHook<>* h)
+{
+    Node* t = static_cast<Node*>(h);
+    t->height = 1 + std::max(Links::height(t->child[Left]), Links::height(t->child[Right]));
+
+    if constexpr (IsAugmented)
+    {
+        t->aggregate = Augmentation::combine(
+            Augmentation::combine(aggregateOf(childOf(t, Left)), Augmentation::of(t->value)),
+            aggregateOf(childOf(t, Right)));
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::deleteTree(Node* t) noexcept
+{
+    if (t == nullptr)
+    {
+        return;
+    }
+    if (childOf(t, Left) != nullptr)
+    {
+        deleteTree(childOf(t, Left));
+    }
+    if (childOf(t, Right) != nullptr)
+    {
+        deleteTree(childOf(t, Right));
+    }
+    delete t;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::~AVLTree() noexcept
+{
+    deleteTree(_root);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::copyTree(Node* t, Node* parent)
+{
+    if (t == nullptr)
+    {
+        return nullptr;
+    }
+
+    Node* copy = new Node(*t);
+    copy->child[Left] = copyTree(childOf(t, Left), copy);
+    copy->child[Right] = copyTree(childOf(t, Right), copy);
+    copy->parent = parent;
+    copy->height = t->height;
+
+    return copy;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AVLTree(const AVLTree& t)
+    :_sz{t._sz}, _shouldBalance{t._shouldBalance}
+{
+    _root = copyTree(t._root, nullptr);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AVLTree(AVLTree&& t) noexcept
+    :_root{nullptr}, _sz{0}, _shouldBalance{false}
+{
+    std::swap(_root, t._root);
+    std::swap(_sz, t._sz);
+    std::swap(_shouldBalance, t._shouldBalance);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>& AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::operator=(const AVLTree& t)
+{
+    deleteTree(_root);
+    _sz = t._sz;
+    _shouldBalance = t._shouldBalance;
+    _root = copyTree(t._root, nullptr);
+
+    return *this;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>& AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::operator=(AVLTree&& t) noexcept
+{
+    std::swap(_root, t._root);
+    std::swap(_sz, t._sz);
+    std::swap(_shouldBalance, t._shouldBalance);
+
+    return *this;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::locate(
+    const Probe& probe, Node*& parent, int& dir) const
+{
+    // Returns the node with the probe's key if there is one.  Otherwise, the
+    // key belongs in the empty subtree in direction dir from parent.
+    parent = nullptr;
+    dir = Left;
+    Node* cur = _root;
+    while (cur != nullptr)
+    {
+        prefetchChildren(cur);
+        int comparison = compare(probe, cur);
+        if (comparison == 0)
+        {
+            return cur;
+        }
+        parent = cur;
+        dir = comparison < 0 ? Left : Right;
+        cur = childOf(cur, dir);
+    }
+    return nullptr;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::link(Node* t, Node* parent, int dir)
+{
+    AVLHook<>* root = _root;
+    Node* unchanged = static_cast<Node*>(Links::link(root, t, parent, dir, _shouldBalance, updateNode));
+    _root = static_cast<Node*>(root);
+    ++_sz;
+
+    updateFrom(unchanged);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::unlink(Node* t)
+{
+    AVLHook<>* root = _root;
+    Node* unchanged = static_cast<Node*>(Links::unlink(root, t, _shouldBalance, updateNode));
+    _root = static_cast<Node*>(root);
+    --_sz;
+
+    updateFrom(unchanged);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::updateFrom(Node* t)
+{
+    // Above the point where retracing stopped, no heights have changed, but
+    // the aggregates of every subtree that gained or lost a node have.
+    if constexpr (IsAugmented)
+    {
+        for (; t != nullptr; t = parentOf(t))
+        {
+            updateNode(t);
+        }
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename... Args>
+std::pair<typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node*, bool>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::emplace(const KeyType& key, Args&&... args)
+{
+    Probe probe = makeProbe(key);
+    Node* parent;
+    int dir;
+    Node* existing = locate(probe, parent, dir);
+    if (existing != nullptr)
+    {
+        return {existing, false};
+    }
+
+    Node* added = new Node{{}, {}, {}, ValueType(std::forward<Args>(args)...)};
+    if constexpr (HasPrefix)
+    {
+        added->prefix = probe.prefix;
+    }
+    link(added, parent, dir);
+
+    return {added, true};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::erase(Node* t)
+{
+    unlink(t);
+    delete t;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::ConstIterator
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::erase(ConstIterator position)
+{
+    Node* t = position._node;
+    ++position;
+    erase(t);
+    return position;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::NodeHandle
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::extract(ConstIterator position)
+{
+    unlink(position._node);
+    return NodeHandle{position._node};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+std::pair<typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::ConstIterator, bool>
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::insert(NodeHandle&& handle)
+{
+    if (handle.empty())
+    {
+        return {end(), false};
+    }
+
+    Node* parent;
+    int dir;
+    Node* existing = locate(makeProbe(keyOf(handle._node)), parent, dir);
+    if (existing != nullptr)
+    {
+        return {iteratorTo(existing), false};
+    }
+
+    Node* t = handle._node;
+    handle._node = nullptr;
+    link(t, parent, dir);
+
+    return {iteratorTo(t), true};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+bool AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::erase(const KeyType& key)
+{
+    Node* t = find(key);
+    if (t == nullptr)
+    {
+        return false;
+    }
+
+    erase(t);
+    return true;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::find(
+    const KeyType& key) const
+{
+#ifdef AVLTREE_BRANCHLESS_SEARCH
+    if constexpr (std::is_arithmetic_v<KeyType>)
+    {
+        // Arithmetic keys are cheap to compare, so rather than testing for
+        // equality at every level, the descent always runs to the bottom of
+        // the tree, choosing each child without a branch.  The last node
+        // whose key is not greater than the one being sought is the only one
+        // that can match, so equality is checked once, at the end.
+        //
+        // This removes the mispredicted branch at each level, but it also
+        // makes each load wait for the comparison before it, where a branch
+        // would let the processor speculatively start loading a child.  On
+        // the machines this was measured on, that made lookups slower, and
+        // much slower in trees larger than the cache, so it is opt-in.
+        std::uintptr_t candidate = 0;
+        Node* cur = _root;
+        while (cur != nullptr)
+        {
+            bool goRight = !(key < keyOf(cur));
+            std::uintptr_t mask = -static_cast<std::uintptr_t>(goRight);
+            candidate = (reinterpret_cast<std::uintptr_t>(cur) & mask) | (candidate & ~mask);
+            cur = childOf(cur, goRight);
+        }
+        Node* match = reinterpret_cast<Node*>(candidate);
+        return match != nullptr && keyOf(match) == key ? match : nullptr;
+    }
+#endif
+
+    Probe probe = makeProbe(key);
+    Node* cur = _root;
+    while (cur != nullptr)
+    {
+        prefetchChildren(cur);
+        int comparison = compare(probe, cur);
+        if (comparison == 0)
+        {
+            return cur;
+        }
+        cur = childOf(cur, comparison > 0);
+    }
+    return nullptr;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::lowerBound(const KeyType& key) const
+{
+    Probe probe = makeProbe(key);
+    Node* bound = nullptr;
+    Node* cur = _root;
+    while (cur != nullptr)
+    {
+        prefetchChildren(cur);
+        int comparison = compare(probe, cur);
+        if (comparison == 0)
+        {
+            return cur;
+        }
+        if (comparison < 0)
+        {
+            bound = cur;
+        }
+        cur = childOf(cur, comparison > 0);
+    }
+    return bound;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename ModifyFunction>
+bool AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::modify(const KeyType& key, ModifyFunction&& modify)
+{
+    Node* t = find(key);
+    if (t == nullptr)
+    {
+        return false;
+    }
+
+    this->modify(t, modify);
+    return true;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename ModifyFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::modify(Node* t, ModifyFunction&& modify)
+{
+    modify(t->value);
+    updateFrom(t);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AggregateType
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::aggregateFromR(Node* t, const KeyType& lo) const
+{
+    if (t == nullptr)
+    {
+        return Augmentation::identity();
+    }
+    if (keyOf(t) < lo)
+    {
+        return aggregateFromR(childOf(t, Right), lo);
+    }
+    return Augmentation::combine(
+        Augmentation::combine(aggregateFromR(childOf(t, Left), lo), Augmentation::of(t->value)),
+        aggregateOf(childOf(t, Right)));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AggregateType
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::aggregateBelowR(Node* t, const KeyType& hi) const
+{
+    if (t == nullptr)
+    {
+        return Augmentation::identity();
+    }
+    if (!(keyOf(t) < hi))
+    {
+        return aggregateBelowR(childOf(t, Left), hi);
+    }
+    return Augmentation::combine(
+        Augmentation::combine(aggregateOf(childOf(t, Left)), Augmentation::of(t->value)),
+        aggregateBelowR(childOf(t, Right), hi));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::AggregateType
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::aggregate(const KeyType* lo, const KeyType* hi) const
+{
+    // Descend to the first node inside the range.  Below it, the range is
+    // split into a part bounded only from below, in its left subtree, and a
+    // part bounded only from above, in its right subtree, each of which is
+    // found along a single path.
+    Node* t = _root;
+    while (t != nullptr)
+    {
+        if (lo != nullptr && keyOf(t) < *lo)
+        {
+            t = childOf(t, Right);
+        } else if (hi != nullptr && !(keyOf(t) < *hi))
+        {
+            t = childOf(t, Left);
+        } else
+        {
+            break;
+        }
+    }
+
+    if (t == nullptr)
+    {
+        return Augmentation::identity();
+    }
+
+    AggregateType left = lo != nullptr ? aggregateFromR(childOf(t, Left), *lo) : aggregateOf(childOf(t, Left));
+    AggregateType right = hi != nullptr ? aggregateBelowR(childOf(t, Right), *hi) : aggregateOf(childOf(t, Right));
+    return Augmentation::combine(Augmentation::combine(left, Augmentation::of(t->value)), right);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename Predicate>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node*
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::findFirst(Predicate&& predicate) const
+{
+    AggregateType prefix = Augmentation::identity();
+    Node* cur = _root;
+    while (cur != nullptr)
+    {
+        AggregateType throughLeft = Augmentation::combine(prefix, aggregateOf(childOf(cur, Left)));
+        if (childOf(cur, Left) != nullptr && predicate(throughLeft))
+        {
+            cur = childOf(cur, Left);
+            continue;
+        }
+
+        AggregateType throughCur = Augmentation::combine(throughLeft, Augmentation::of(cur->value));
+        if (predicate(throughCur))
+        {
+            return cur;
+        }
+        prefix = throughCur;
+        cur = childOf(cur, Right);
+    }
+    return nullptr;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename DifferenceFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::differences(const AVLTree& other, DifferenceFunction&& visit) const
+{
+    differencesR(other, _root, nullptr, false, nullptr, visit);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename DifferenceFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::differencesR(const AVLTree& other, const Node* t, const Node* lo, bool loShared,
+    const Node* hi, DifferenceFunction& visit) const
+{
+    // t's subtree holds this tree's values whose keys lie strictly between
+    // lo's and hi's, while the other tree's aggregate is taken from lo's key
+    // onward, so it counts lo's value, too, if both trees have it.
+    AggregateType mine = aggregateOf(t);
+    if (loShared)
+    {
+        mine = Augmentation::combine(Augmentation::of(lo->value), mine);
+    }
+    AggregateType theirs = other.aggregate(
+        lo != nullptr ? &keyOf(lo) : nullptr, hi != nullptr ? &keyOf(hi) : nullptr);
+    if (mine == theirs)
+    {
+        return;
+    }
+
+    if (t == nullptr)
+    {
+        // Every value the other tree has in this range is missing here.
+        Node* cur = lo != nullptr ? other.lowerBound(keyOf(lo)) : other.first();
+        if (cur != nullptr && lo != nullptr && keyOf(cur) == keyOf(lo))
+        {
+            cur = next(cur);
+        }
+        for (; cur != nullptr && (hi == nullptr || keyOf(cur) < keyOf(hi)); cur = next(cur))
+        {
+            visit(cur->value, false);
+        }
+        return;
+    }
+
+    bool shared = other.find(keyOf(t)) != nullptr;
+    if (!shared)
+    {
+        visit(t->value, true);
+    }
+    differencesR(other, childOf(t, Left), lo, loShared, t, visit);
+    differencesR(other, childOf(t, Right), t, shared, hi, visit);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+const typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node*
+AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::root() const noexcept
+{
+    return _root;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::childOf(const Node* t, int dir) noexcept
+{
+    return static_cast<Node*>(t->child[dir]);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::parentOf(const Node* t) noexcept
+{
+    return static_cast<Node*>(t->parent);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::first() const noexcept
+{
+    return _root == nullptr ? nullptr : static_cast<Node*>(Links::extreme(_root, Left));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::last() const noexcept
+{
+    return _root == nullptr ? nullptr : static_cast<Node*>(Links::extreme(_root, Right));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::next(const Node* t) noexcept
+{
+    return static_cast<Node*>(Links::step(t, Right));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::Node* AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::prev(const Node* t) noexcept
+{
+    return static_cast<Node*>(Links::step(t, Left));
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::ConstIterator AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::begin() const noexcept
+{
+    return ConstIterator{this, first()};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::ConstIterator AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::end() const noexcept
+{
+    return ConstIterator{this, nullptr};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+typename AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::ConstIterator AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::iteratorTo(Node* t) const noexcept
+{
+    return ConstIterator{this, t};
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+std::size_t AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::size() const noexcept
+{
+    return _sz;
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+int AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::height() const noexcept
+{
+    return Links::height(_root);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::preorderR(VisitFunction& visit, Node* t) const
+{
+    visit(t->value);
+
+    if (childOf(t, Left) != nullptr)
+    {
+        preorderR(visit, childOf(t, Left));
+    }
+    if (childOf(t, Right) != nullptr)
+    {
+        preorderR(visit, childOf(t, Right));
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::preorder(VisitFunction&& visit) const
+{
+    if (_root != nullptr)
+    {
+        preorderR(visit, _root);
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::inorderR(VisitFunction& visit, Node* t) const
+{
+    if (t != nullptr)
+    {
+        // The right child won't be needed until the whole left subtree has
+        // been visited, so fetching it now hides its latency completely.
+        prefetchChildren(t);
+        inorderR(visit, childOf(t, Left));
+        visit(t->value);
+        inorderR(visit, childOf(t, Right));
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::inorder(VisitFunction&& visit) const
+{
+    inorderR(visit, _root);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::postorderR(VisitFunction& visit, Node* t) const
+{
+    if (childOf(t, Left) != nullptr)
+    {
+        postorderR(visit, childOf(t, Left));
+    }
+    if (childOf(t, Right) != nullptr)
+    {
+        postorderR(visit, childOf(t, Right));
+    }
+    visit(t->value);
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename VisitFunction>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::postorder(VisitFunction&& visit) const
+{
+    if (_root != nullptr)
+    {
+        postorderR(visit, _root);
+    }
+}
+
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename OutputIterator>
+void AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::copyR(const Node* t, std::size_t& count, OutputIterator& out) const
+{
+    if (t == nullptr || count == 0)
+    {
+        return;
+    }
+
+    copyR(childOf(t, Left), count, out);
+    if (count > 0)
+    {
+        *out = t->value;
+        ++out;
+        --count;
+        copyR(childOf(t, Right), count, out);
+    }
+}
+
+
+template <typename KeyType, typename ValueType, typename KeyOfValue, typename Augmentation>
+template <typename OutputIterator>
+OutputIterator AVLTree<KeyType, ValueType, KeyOfValue, Augmentation>::copyTo(const Node* t, std::size_t count, OutputIterator out) const
+{
+    // Copy t and its right subtree, then move up to the nearest ancestor
+    // whose left subtree t is in, which is the next node after them, and do
+    // the same there.  Each subtree is copied by an inorder traversal, which
+    // is much faster than stepping from node to node through the parents.
+    while (t != nullptr && count > 0)
+    {
+        *out = t->value;
+        ++out;
+        --count;
+        copyR(childOf(t, Right), count, out);
+
+        const Node* from = t;
+        t = parentOf(t);
+        while (t != nullptr && childOf(t, Right) == from)
+        {
+            from = t;
+            t = parentOf(t);
+        }
+    }
+    return out;
+}
+
+
+#endif
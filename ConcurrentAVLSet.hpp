@@ -0,0 +1,461 @@
+// ConcurrentAVLSet.hpp
+//
+// A ConcurrentAVLSet is an AVL tree that any number of threads can add to
+// and search at the same time.  Rather than one lock for the whole tree,
+// every node has its own lock, and threads use lock coupling (also called
+// hand-over-hand locking) on their way down from the root: a thread locks
+// a child before it lets go of anything above it.
+//
+// An insertion can only change the heights of the nodes below the deepest
+// node on its path whose subtrees are not already the same height, since
+// that node either becomes balanced or is rotated back to its old height.
+// So while descending, a thread lets go of every lock above that node's
+// parent, which it needs to keep so it can relink a rotated subtree.  In
+// practice only the last few levels stay locked, and insertions into
+// disjoint parts of the tree proceed in parallel.
+//
+// Unlike an AVLSet, a ConcurrentAVLSet always balances itself.
+
+#ifndef CONCURRENTAVLSET_HPP
+#define CONCURRENTAVLSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include "Set.hpp"
+
+
+template <typename ElementType>
+class ConcurrentAVLSet : public Set<ElementType>
+{
+public:
+    // Initializes a ConcurrentAVLSet to be empty.
+    ConcurrentAVLSet();
+
+    // Cleans up the ConcurrentAVLSet so that it leaks no memory.  No other
+    // thread may be using the set when it is destroyed.
+    ~ConcurrentAVLSet() noexcept override;
+
+    ConcurrentAVLSet(const ConcurrentAVLSet& s) = delete;
+    ConcurrentAVLSet& operator=(const ConcurrentAVLSet& s) = delete;
+
+
+    bool isImplemented() const noexcept override;
+
+
+    // add() adds an element to the set.  If the element is already in the set,
+    // this function has no effect.  It is safe to call add() and contains()
+    // from any number of threads at the same time.
+    void add(const ElementType& element) override;
+
+
+    // contains() returns true if the given element is already in the set,
+    // false otherwise.
+    bool contains(const ElementType& element) const override;
+
+
+    // size() returns the number of elements in the set, or the largest
+    // unsigned int if there are more elements than that; size64() always
+    // returns the number of elements.
+    unsigned int size() const noexcept override;
+
+    std::size_t size64() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    int height() const;
+
+
+private:
+    struct Node
+    {
+        explicit Node(const ElementType& element)
+            : left{nullptr}, right{nullptr}, value{element}, height{0}
+        {
+        }
+
+        Node* left;
+        Node* right;
+        ElementType value;
+        int height;
+        std::mutex lock;
+    };
+
+    // No insertion path can be longer than this, because the height of an
+    // AVL tree is less than 1.45 log2(n).
+    static constexpr int MaxPathLength = 96;
+
+    Node* _root;
+    mutable std::mutex _rootLock;
+    std::atomic<std::size_t> _sz;
+
+    void deleteTree(Node* t) noexcept;
+
+    int getHeight(Node* t) const;
+
+    int getBalance(Node* t) const;
+
+    Node* rebalance(Node* t, const ElementType& element);
+
+    // addLocked() does the work of add() once the root lock is held, keeping
+    // track in path, pathLength and anchor of the locks it holds, and returns
+    // true if it added the element.
+    bool addLocked(const ElementType& element, Node** path, int& pathLength, Node*& anchor);
+
+    Node* rotLL(Node* t);
+
+    Node* rotLR(Node* t);
+
+    Node* rotRL(Node* t);
+
+    Node* rotRR(Node* t);
+};
+
+
+template <typename ElementType>
+ConcurrentAVLSet<ElementType>::ConcurrentAVLSet()
+    : _root{nullptr}, _sz{0}
+{
+}
+
+
+template <typename ElementType>
+void ConcurrentAVLSet<ElementType>::deleteTree(Node* t) noexcept
+{
+    if (t == nullptr)
+    {
+        return;
+    }
+    deleteTree(t->left);
+    deleteTree(t->right);
+    delete t;
+}
+
+
+template <typename ElementType>
+ConcurrentAVLSet<ElementType>::~ConcurrentAVLSet() noexcept
+{
+    deleteTree(_root);
+}
+
+
+template <typename ElementType>
+bool ConcurrentAVLSet<ElementType>::isImplemented() const noexcept
+{
+    return true;
+}
+
+
+template <typename ElementType>
+int ConcurrentAVLSet<ElementType>::getHeight(Node* t) const
+{
+    if (t == nullptr)
+    {
+        return -1;
+    }
+    return t->height;
+}
+
+
+template <typename ElementType>
+int ConcurrentAVLSet<ElementType>::getBalance(Node* t) const
+{
+    return getHeight(t->left) - getHeight(t->right);
+}
+
+
+template <typename ElementType>
+typename ConcurrentAVLSet<ElementType>::Node* ConcurrentAVLSet<ElementType>::rotLL(Node* t)
+{
+    Node* a = t->left;
+    Node* t2 = a->right;
+
+    t->left = t2;
+    a->right = t;
+
+    t->height = 1 + std::max(getHeight(t2), getHeight(t->right));
+    a->height = 1 + std::max(getHeight(a->left), getHeight(t));
+
+    return a;
+}
+
+
+template <typename ElementType>
+typename ConcurrentAVLSet<ElementType>::Node* ConcurrentAVLSet<ElementType>::rotLR(Node* t)
+{
+    Node* a = t->left;
+    Node* b = a->right;
+    Node* t2 = b->left;
+    Node* t3 = b->right;
+
+    a->right = t2;
+    t->left = t3;
+    b->left = a;
+    b->right = t;
+
+    a->height = 1 + std::max(getHeight(a->left), getHeight(t2));
+    t->height = 1 + std::max(getHeight(t3), getHeight(t->right));
+    b->height = 1 + std::max(getHeight(a), getHeight(t));
+
+    return b;
+}
+
+
+template <typename ElementType>
+typename ConcurrentAVLSet<ElementType>::Node* ConcurrentAVLSet<ElementType>::rotRL(Node* t)
+{
+    Node* c = t->right;
+    Node* b = c->left;
+    Node* t2 = b->left;
+    Node* t3 = b->right;
+
+    t->right = t2;
+    c->left = t3;
+    b->left = t;
+    b->right = c;
+
+    t->height = 1 + std::max(getHeight(t->left), getHeight(t2));
+    c->height = 1 + std::max(getHeight(t3), getHeight(c->right));
+    b->height = 1 + std::max(getHeight(t), getHeight(c));
+
+    return b;
+}
+
+
+template <typename ElementType>
+typename ConcurrentAVLSet<ElementType>::Node* ConcurrentAVLSet<ElementType>::rotRR(Node* t)
+{
+    Node* b = t->right;
+    Node* t2 = b->left;
+
+    t->right = t2;
+    b->left = t;
+
+    t->height = 1 + std::max(getHeight(t->left), getHeight(t2));
+    b->height = 1 + std::max(getHeight(t), getHeight(b->right));
+
+    return b;
+}
+
+
+template <typename ElementType>
+typename ConcurrentAVLSet<ElementType>::Node* ConcurrentAVLSet<ElementType>::rebalance(
+    Node* t, const ElementType& element)
+{
+    // Every node a rotation touches lies on the insertion path below t, so
+    // all of them are already locked by the calling thread.
+    if (element < t->value)
+    {
+        return element < t->left->value ? rotLL(t) : rotLR(t);
+    }
+    return element < t->right->value ? rotRL(t) : rotRR(t);
+}
+
+
+template <typename ElementType>
+void ConcurrentAVLSet<ElementType>::add(const ElementType& element)
+{
+    // path[0] is the highest node whose height or position might change and
+    // is locked along with everything below it; "anchor" is its parent (or
+    // nullptr for the root pointer), which is locked so that a rotated
+    // subtree can be relinked into it.
+    Node* path[MaxPathLength];
+    int pathLength = 0;
+    Node* anchor = nullptr;
+
+    _rootLock.lock();
+
+    // Every lock still held is released before add() returns, whether it
+    // returns normally or because allocating a node, or copying or comparing
+    // an element, threw an exception, so that no other thread is left
+    // waiting on the locks forever.
+    auto unlockAll = [&]()
+    {
+        if (anchor == nullptr)
+        {
+            _rootLock.unlock();
+        } else
+        {
+            anchor->lock.unlock();
+        }
+        for (int i = 0; i < pathLength; ++i)
+        {
+            path[i]->lock.unlock();
+        }
+    };
+
+    try
+    {
+        if (addLocked(element, path, pathLength, anchor))
+        {
+            ++_sz;
+        }
+    } catch (...)
+    {
+        unlockAll();
+        throw;
+    }
+
+    unlockAll();
+}
+
+
+template <typename ElementType>
+bool ConcurrentAVLSet<ElementType>::addLocked(
+    const ElementType& element, Node** path, int& pathLength, Node*& anchor)
+{
+    if (_root == nullptr)
+    {
+        _root = new Node{element};
+        return true;
+    }
+
+    Node* cur = _root;
+    cur->lock.lock();
+    path[pathLength++] = cur;
+
+    while (true)
+    {
+        if (cur->value == element)
+        {
+            return false;
+        }
+
+        Node*& link = element < cur->value ? cur->left : cur->right;
+        if (link == nullptr)
+        {
+            link = new Node{element};
+            break;
+        }
+
+        Node* next = link;
+        next->lock.lock();
+        if (getBalance(next) != 0)
+        {
+            // The height of next cannot change, so nothing above cur can
+            // be affected by this insertion.
+            if (anchor == nullptr)
+            {
+                _rootLock.unlock();
+            } else
+            {
+                anchor->lock.unlock();
+            }
+            for (int i = 0; i < pathLength - 1; ++i)
+            {
+                path[i]->lock.unlock();
+            }
+            anchor = cur;
+            pathLength = 0;
+        }
+        path[pathLength++] = next;
+        cur = next;
+    }
+
+    for (int i = pathLength - 1; i >= 0; --i)
+    {
+        Node* t = path[i];
+        int oldHeight = t->height;
+        t->height = 1 + std::max(getHeight(t->left), getHeight(t->right));
+
+        if (std::abs(getBalance(t)) > 1)
+        {
+            Node* rotated = rebalance(t, element);
+            if (i > 0)
+            {
+                (path[i - 1]->left == t ? path[i - 1]->left : path[i - 1]->right) = rotated;
+            } else if (anchor == nullptr)
+            {
+                _root = rotated;
+            } else
+            {
+                (anchor->left == t ? anchor->left : anchor->right) = rotated;
+            }
+            break;
+        }
+        if (t->height == oldHeight)
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+template <typename ElementType>
+bool ConcurrentAVLSet<ElementType>::contains(const ElementType& element) const
+{
+    _rootLock.lock();
+    Node* cur = _root;
+    if (cur == nullptr)
+    {
+        _rootLock.unlock();
+        return false;
+    }
+    cur->lock.lock();
+    _rootLock.unlock();
+
+    // Only cur is locked while elements are compared, so it's the only lock
+    // to release if a comparison throws.
+    try
+    {
+        while (true)
+        {
+            if (cur->value == element)
+            {
+                cur->lock.unlock();
+                return true;
+            }
+
+            Node* next = element > cur->value ? cur->right : cur->left;
+            if (next == nullptr)
+            {
+                cur->lock.unlock();
+                return false;
+            }
+            next->lock.lock();
+            cur->lock.unlock();
+            cur = next;
+        }
+    } catch (...)
+    {
+        cur->lock.unlock();
+        throw;
+    }
+}
+
+
+template <typename ElementType>
+unsigned int ConcurrentAVLSet<ElementType>::size() const noexcept
+{
+    return static_cast<unsigned int>(
+        std::min<std::size_t>(size64(), std::numeric_limits<unsigned int>::max()));
+}
+
+
+template <typename ElementType>
+std::size_t ConcurrentAVLSet<ElementType>::size64() const noexcept
+{
+    return _sz.load();
+}
+
+
+template <typename ElementType>
+int ConcurrentAVLSet<ElementType>::height() const
+{
+    std::lock_guard<std::mutex> lock{_rootLock};
+    if (_root == nullptr)
+    {
+        return -1;
+    }
+    std::lock_guard<std::mutex> rootLock{_root->lock};
+    return _root->height;
+}
+
+
+#endif
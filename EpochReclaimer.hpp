@@ -0,0 +1,249 @@
+// EpochReclaimer.hpp
+//
+// An EpochReclaimer provides epoch-based memory reclamation, so that memory
+// which has been unlinked from a shared structure is only freed once every
+// reader that might still be looking at it has finished.
+//
+// Readers bracket each access with a Guard, which announces the global epoch
+// the reader started in and withdraws that announcement when it is
+// destroyed.  Each reader announces its epoch in a slot of its own (see
+// ThreadSlots.hpp), which it never waits for, however many readers there
+// are; entering and leaving only touch that slot, and nothing else a reader
+// does needs to be synchronized.  Writers unlink
+// memory from the structure first and then hand it to retire(), which tags it
+// with the current epoch and advances the global epoch.  Retired memory is
+// freed once no active reader has announced an epoch at or before its tag.
+//
+// Note that an EpochReclaimer only makes freeing safe.  The structure being
+// read must still never be modified in a way that a concurrent reader could
+// observe half-done.  An AVLSet rotates its nodes in place when it adds an
+// element, so readers should be given immutable versions of a set, each
+// retired as a whole once it has been replaced, which is how RCUAVLSet.hpp
+// uses it.
+
+#ifndef EPOCHRECLAIMER_HPP
+#define EPOCHRECLAIMER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "ThreadSlots.hpp"
+
+
+class EpochReclaimer
+{
+private:
+    static constexpr std::uint64_t Inactive = UINT64_MAX;
+
+    // An Announcement is the epoch a reader entered in, or Inactive if the
+    // slot holding it has no reader.
+    struct Announcement
+    {
+        std::atomic<std::uint64_t> epoch{Inactive};
+    };
+
+    using Slot = ThreadSlots<Announcement>::Slot;
+
+public:
+    // A Guard marks the lifetime of one reader's access.  Pointers loaded
+    // from the protected structure while a Guard is alive remain valid until
+    // the Guard is destroyed.
+    class Guard
+    {
+    public:
+        explicit Guard(EpochReclaimer& reclaimer);
+        ~Guard() noexcept;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        EpochReclaimer& _reclaimer;
+        Slot& _slot;
+    };
+
+public:
+    // Initializes an EpochReclaimer with nothing retired.
+    EpochReclaimer();
+
+    // Frees everything that is still retired.  No Guard may be alive when
+    // an EpochReclaimer is destroyed.
+    ~EpochReclaimer() noexcept;
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+
+    // retire() hands memory that is no longer reachable by new readers over
+    // to the reclaimer, which calls "deleter" on it once every reader that
+    // might still see it has left.  Retiring also frees whatever earlier
+    // retirements have become safe to free.
+    void retire(void* p, void (*deleter)(void*));
+
+
+    // retire() for a single object allocated with new.
+    template <typename T>
+    void retire(T* p);
+
+
+    // synchronize() waits until every reader that was active when it was
+    // called has left, then frees everything that has been retired.
+    void synchronize();
+
+
+private:
+    struct Retired
+    {
+        void* p;
+        void (*deleter)(void*);
+        std::uint64_t epoch;
+        Retired* next;
+    };
+
+    ThreadSlots<Announcement> _slots;
+    std::atomic<std::uint64_t> _globalEpoch;
+    std::mutex _retiredMutex;
+    Retired* _retired;
+
+    Slot& enter();
+
+    void leave(Slot& slot) noexcept;
+
+    std::uint64_t oldestActiveEpoch() const;
+
+    void freeOlderThan(std::uint64_t epoch);
+};
+
+
+inline EpochReclaimer::Guard::Guard(EpochReclaimer& reclaimer)
+    : _reclaimer{reclaimer}, _slot{reclaimer.enter()}
+{
+}
+
+
+inline EpochReclaimer::Guard::~Guard() noexcept
+{
+    _reclaimer.leave(_slot);
+}
+
+
+inline EpochReclaimer::EpochReclaimer()
+    : _globalEpoch{0}, _retired{nullptr}
+{
+}
+
+
+inline EpochReclaimer::~EpochReclaimer() noexcept
+{
+    while (_retired != nullptr)
+    {
+        Retired* r = _retired;
+        _retired = r->next;
+        r->deleter(r->p);
+        delete r;
+    }
+}
+
+
+inline EpochReclaimer::Slot& EpochReclaimer::enter()
+{
+    Slot& slot = _slots.claim();
+
+    // The announcement has to be visible to a writer's scan of the slots
+    // before this reader loads anything from the protected structure.  A
+    // store followed by a load is the one ordering that release and acquire
+    // don't provide, even when the store is sequentially consistent, so it
+    // takes a full fence, which pairs with the one in retire() and
+    // synchronize().
+    slot.epoch.store(_globalEpoch.load());
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return slot;
+}
+
+
+inline void EpochReclaimer::leave(Slot& slot) noexcept
+{
+    slot.epoch.store(Inactive, std::memory_order_release);
+    ThreadSlots<Announcement>::release(slot);
+}
+
+
+inline std::uint64_t EpochReclaimer::oldestActiveEpoch() const
+{
+    std::uint64_t oldest = Inactive;
+    _slots.forEach([&](const Slot& s) { oldest = std::min(oldest, s.epoch.load()); });
+    return oldest;
+}
+
+
+inline void EpochReclaimer::freeOlderThan(std::uint64_t epoch)
+{
+    Retired* toFree = nullptr;
+    {
+        std::lock_guard<std::mutex> lock{_retiredMutex};
+        Retired** cur = &_retired;
+        while (*cur != nullptr)
+        {
+            if ((*cur)->epoch < epoch)
+            {
+                Retired* r = *cur;
+                *cur = r->next;
+                r->next = toFree;
+                toFree = r;
+            } else
+            {
+                cur = &(*cur)->next;
+            }
+        }
+    }
+
+    while (toFree != nullptr)
+    {
+        Retired* r = toFree;
+        toFree = r->next;
+        r->deleter(r->p);
+        delete r;
+    }
+}
+
+
+inline void EpochReclaimer::retire(void* p, void (*deleter)(void*))
+{
+    // A reader that announced this epoch may have loaded the pointer before
+    // it was unlinked; readers announcing any later epoch cannot have.
+    std::uint64_t epoch = _globalEpoch.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock{_retiredMutex};
+        _retired = new Retired{p, deleter, epoch, _retired};
+    }
+
+    // Either this scan sees the announcement of a reader that loaded the
+    // pointer before it was unlinked, or that reader's load, which follows
+    // its own fence in enter(), sees the unlinking.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    freeOlderThan(oldestActiveEpoch());
+}
+
+
+template <typename T>
+void EpochReclaimer::retire(T* p)
+{
+    retire(p, [](void* q) { delete static_cast<T*>(q); });
+}
+
+
+inline void EpochReclaimer::synchronize()
+{
+    std::uint64_t epoch = _globalEpoch.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (oldestActiveEpoch() <= epoch)
+    {
+        std::this_thread::yield();
+    }
+    freeOlderThan(epoch + 1);
+}
+
+
+#endif
@@ -0,0 +1,195 @@
+// FlatCombiningAVLSet.hpp
+//
+// A FlatCombiningAVLSet is an AVLSet that many threads can add to at the
+// same time, using flat combining to cut down on contention for its lock.
+//
+// A thread that wants to add an element publishes it in a slot of its own,
+// then tries to take the lock.  Whichever thread gets the lock becomes the
+// combiner: it collects every element that has been published, sorts them,
+// adds them to the set one after the other, and then marks each of their
+// slots as done.  Threads that did not get the lock simply wait for their
+// slot to be marked done.  Under contention, this means the lock changes
+// hands once per batch rather than once per element, and the upper levels
+// of the tree stay in the combiner's cache for the whole batch.
+
+#ifndef FLATCOMBININGAVLSET_HPP
+#define FLATCOMBININGAVLSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AVLSet.hpp"
+#include "Set.hpp"
+#include "ThreadSlots.hpp"
+
+
+template <typename ElementType>
+class FlatCombiningAVLSet : public Set<ElementType>
+{
+public:
+    // Initializes a FlatCombiningAVLSet to be empty, with or without balancing.
+    explicit FlatCombiningAVLSet(bool shouldBalance = true);
+
+    FlatCombiningAVLSet(const FlatCombiningAVLSet&) = delete;
+    FlatCombiningAVLSet& operator=(const FlatCombiningAVLSet&) = delete;
+
+
+    bool isImplemented() const noexcept override;
+
+
+    // add() adds an element to the set.  If the element is already in the set,
+    // this function has no effect.  The element has been added by the time
+    // add() returns, though possibly by another thread.
+    void add(const ElementType& element) override;
+
+
+    // contains() returns true if the given element is already in the set,
+    // false otherwise.
+    bool contains(const ElementType& element) const override;
+
+
+    // size() returns the number of elements in the set, or the largest
+    // unsigned int if there are more elements than that; size64() always
+    // returns the number of elements.
+    unsigned int size() const noexcept override;
+
+    std::size_t size64() const noexcept;
+
+
+private:
+    // A Request is the element a thread is waiting to have added, or nullptr
+    // if the slot holding it has no element waiting.
+    struct Request
+    {
+        std::atomic<const ElementType*> element{nullptr};
+    };
+
+    using Slot = typename ThreadSlots<Request>::Slot;
+
+    ThreadSlots<Request> _slots;
+    mutable std::mutex _lock;
+    AVLSet<ElementType> _set;
+
+    // The combiner keeps a copy of the set's size here, so that size() can
+    // read it without taking the lock.
+    std::atomic<std::size_t> _sz;
+
+    // The slots whose requests the combiner is adding, which is kept between
+    // batches so that its storage can be reused.
+    std::vector<Slot*> _batch;
+
+    void combine();
+};
+
+
+template <typename ElementType>
+FlatCombiningAVLSet<ElementType>::FlatCombiningAVLSet(bool shouldBalance)
+    : _set{shouldBalance}, _sz{0}
+{
+}
+
+
+template <typename ElementType>
+bool FlatCombiningAVLSet<ElementType>::isImplemented() const noexcept
+{
+    return true;
+}
+
+
+template <typename ElementType>
+void FlatCombiningAVLSet<ElementType>::combine()
+{
+    _batch.clear();
+    _slots.forEach(
+        [this](Slot& s)
+        {
+            if (s.element.load(std::memory_order_acquire) != nullptr)
+            {
+                _batch.push_back(&s);
+            }
+        });
+
+    // Adding in ascending order means that consecutive insertions follow
+    // mostly the same path, which is still in cache from the previous one.
+    std::sort(_batch.begin(), _batch.end(),
+        [](const Slot* a, const Slot* b)
+        {
+            return *a->element.load(std::memory_order_relaxed) < *b->element.load(std::memory_order_relaxed);
+        });
+
+    // The size is published before any request is marked done, so a thread
+    // whose add() has returned sees it in size().
+    for (Slot* s : _batch)
+    {
+        _set.add(*s->element.load(std::memory_order_relaxed));
+        _sz.store(_set.size64(), std::memory_order_relaxed);
+    }
+    for (Slot* s : _batch)
+    {
+        s->element.store(nullptr, std::memory_order_release);
+    }
+}
+
+
+template <typename ElementType>
+void FlatCombiningAVLSet<ElementType>::add(const ElementType& element)
+{
+    Slot& slot = _slots.claim();
+    slot.element.store(&element, std::memory_order_release);
+
+    while (slot.element.load(std::memory_order_acquire) != nullptr)
+    {
+        if (_lock.try_lock())
+        {
+            std::lock_guard<std::mutex> lock{_lock, std::adopt_lock};
+            try
+            {
+                combine();
+            } catch (...)
+            {
+                // The request points to the caller's element, which won't
+                // outlive this call, so it's withdrawn before the lock is
+                // released and the next combiner can see it.  Other threads'
+                // requests are left for the next combiner to retry.
+                slot.element.store(nullptr, std::memory_order_release);
+                ThreadSlots<Request>::release(slot);
+                throw;
+            }
+        } else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    ThreadSlots<Request>::release(slot);
+}
+
+
+template <typename ElementType>
+bool FlatCombiningAVLSet<ElementType>::contains(const ElementType& element) const
+{
+    std::lock_guard<std::mutex> lock{_lock};
+    return _set.contains(element);
+}
+
+
+template <typename ElementType>
+unsigned int FlatCombiningAVLSet<ElementType>::size() const noexcept
+{
+    return static_cast<unsigned int>(
+        std::min<std::size_t>(size64(), std::numeric_limits<unsigned int>::max()));
+}
+
+
+template <typename ElementType>
+std::size_t FlatCombiningAVLSet<ElementType>::size64() const noexcept
+{
+    return _sz.load(std::memory_order_acquire);
+}
+
+
+#endif
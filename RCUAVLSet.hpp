@@ -0,0 +1,187 @@
+// RCUAVLSet.hpp
+//
+// An RCUAVLSet publishes an AVLSet to many concurrent readers using
+// read-copy-update.  The published AVLSet is never modified; readers get a
+// pointer to it with a single atomic load, and never wait for writers or
+// for each other, however many of them there are and however deeply their
+// reads are nested, since the EpochReclaimer gives every reader a slot of
+// its own, adding slots as more readers arrive.  A writer builds a new
+// AVLSet (usually by copying the current one and changing the copy), then
+// publishes it with a single atomic store.  The version it replaced is
+// retired to the EpochReclaimer, which deletes it once every reader that
+// might still be using it is done.
+//
+// This suits sets that are read constantly and rebuilt now and then.  Every
+// update copies the whole set, so it is a poor fit for sets that change
+// often.
+
+#ifndef RCUAVLSET_HPP
+#define RCUAVLSET_HPP
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include "AVLSet.hpp"
+#include "EpochReclaimer.hpp"
+
+
+template <typename ElementType>
+class RCUAVLSet
+{
+public:
+    // A ReadHandle gives a reader access to the version of the set that was
+    // published when the handle was created.  That version stays valid, and
+    // does not change, for as long as the handle is alive.  Handles should
+    // be short-lived, since they keep old versions from being deleted.
+    class ReadHandle
+    {
+    public:
+        ReadHandle(EpochReclaimer& reclaimer, const std::atomic<AVLSet<ElementType>*>& current);
+
+        const AVLSet<ElementType>& operator*() const noexcept;
+        const AVLSet<ElementType>* operator->() const noexcept;
+
+    private:
+        EpochReclaimer::Guard _guard;
+        const AVLSet<ElementType>* _set;
+    };
+
+public:
+    // Initializes an RCUAVLSet that publishes an empty AVLSet.
+    explicit RCUAVLSet(bool shouldBalance = true);
+
+    // Initializes an RCUAVLSet that publishes the given AVLSet.
+    explicit RCUAVLSet(AVLSet<ElementType> initial);
+
+    // Deletes the published version and any retired ones.  No ReadHandle
+    // may be alive when an RCUAVLSet is destroyed.
+    ~RCUAVLSet() noexcept;
+
+    RCUAVLSet(const RCUAVLSet&) = delete;
+    RCUAVLSet& operator=(const RCUAVLSet&) = delete;
+
+
+    // read() returns a handle to the currently published version of the set.
+    ReadHandle read() const;
+
+
+    // contains() returns true if the given element is in the currently
+    // published version of the set, false otherwise.
+    bool contains(const ElementType& element) const;
+
+
+    // publish() replaces the published version of the set with the given one.
+    void publish(AVLSet<ElementType> s);
+
+
+    // update() copies the published version of the set, calls "modify" on the
+    // copy, and then publishes the copy.  Concurrent calls to update() and
+    // publish() are serialized, so no update is lost.
+    template <typename ModifyFunction>
+    void update(ModifyFunction modify);
+
+
+private:
+    mutable EpochReclaimer _reclaimer;
+    std::atomic<AVLSet<ElementType>*> _current;
+    std::mutex _writeLock;
+
+    void replace(AVLSet<ElementType>* next);
+};
+
+
+template <typename ElementType>
+RCUAVLSet<ElementType>::ReadHandle::ReadHandle(
+    EpochReclaimer& reclaimer, const std::atomic<AVLSet<ElementType>*>& current)
+    : _guard{reclaimer}, _set{current.load(std::memory_order_acquire)}
+{
+}
+
+
+template <typename ElementType>
+const AVLSet<ElementType>& RCUAVLSet<ElementType>::ReadHandle::operator*() const noexcept
+{
+    return *_set;
+}
+
+
+template <typename ElementType>
+const AVLSet<ElementType>* RCUAVLSet<ElementType>::ReadHandle::operator->() const noexcept
+{
+    return _set;
+}
+
+
+template <typename ElementType>
+RCUAVLSet<ElementType>::RCUAVLSet(bool shouldBalance)
+    : _current{new AVLSet<ElementType>{shouldBalance}}
+{
+}
+
+
+template <typename ElementType>
+RCUAVLSet<ElementType>::RCUAVLSet(AVLSet<ElementType> initial)
+    : _current{new AVLSet<ElementType>{std::move(initial)}}
+{
+}
+
+
+template <typename ElementType>
+RCUAVLSet<ElementType>::~RCUAVLSet() noexcept
+{
+    delete _current.load();
+}
+
+
+template <typename ElementType>
+typename RCUAVLSet<ElementType>::ReadHandle RCUAVLSet<ElementType>::read() const
+{
+    return ReadHandle{_reclaimer, _current};
+}
+
+
+template <typename ElementType>
+bool RCUAVLSet<ElementType>::contains(const ElementType& element) const
+{
+    return read()->contains(element);
+}
+
+
+template <typename ElementType>
+void RCUAVLSet<ElementType>::replace(AVLSet<ElementType>* next)
+{
+    AVLSet<ElementType>* previous = _current.exchange(next, std::memory_order_acq_rel);
+    _reclaimer.retire(previous);
+}
+
+
+template <typename ElementType>
+void RCUAVLSet<ElementType>::publish(AVLSet<ElementType> s)
+{
+    AVLSet<ElementType>* next = new AVLSet<ElementType>{std::move(s)};
+
+    std::lock_guard<std::mutex> lock{_writeLock};
+    replace(next);
+}
+
+
+template <typename ElementType>
+template <typename ModifyFunction>
+void RCUAVLSet<ElementType>::update(ModifyFunction modify)
+{
+    std::lock_guard<std::mutex> lock{_writeLock};
+
+    AVLSet<ElementType>* next = new AVLSet<ElementType>{*_current.load(std::memory_order_relaxed)};
+    try
+    {
+        modify(*next);
+    } catch (...)
+    {
+        delete next;
+        throw;
+    }
+    replace(next);
+}
+
+
+#endif
@@ -0,0 +1,412 @@
+// ReplicatedAVLSet.hpp
+//
+// A ReplicatedAVLSet keeps one AVLSet per NUMA node, so that lookups never
+// have to reach across the interconnect into another socket's memory.
+//
+// Additions are not applied to every replica directly.  Instead, they are
+// appended to a shared operation log, and each replica replays the log up
+// to its end before it is read (this is the approach of Node Replication).
+// Because a thread only ever replays the log into the replica for the node
+// it is running on, every tree node is first touched, and so placed by the
+// kernel, on the node that will read it.  No libnuma is required.  If a
+// replica falls too far behind because nothing on its node reads it, the
+// thread adding an element replays the log into it so that the log stays
+// bounded.
+//
+// The NUMA topology is read from /sys/devices/system/node on Linux.  On any
+// other system, or if the topology cannot be read, there is one replica and
+// a ReplicatedAVLSet behaves like an AVLSet with a reader/writer lock.
+
+#ifndef REPLICATEDAVLSET_HPP
+#define REPLICATEDAVLSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <string>
+#include "AVLSet.hpp"
+#include "Set.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+template <typename ElementType>
+class ReplicatedAVLSet : public Set<ElementType>
+{
+public:
+    // Initializes a ReplicatedAVLSet to be empty, with or without balancing,
+    // with one replica for each NUMA node that is online.
+    explicit ReplicatedAVLSet(bool shouldBalance = true);
+
+    // Cleans up the ReplicatedAVLSet so that it leaks no memory.
+    ~ReplicatedAVLSet() noexcept override;
+
+    ReplicatedAVLSet(const ReplicatedAVLSet&) = delete;
+    ReplicatedAVLSet& operator=(const ReplicatedAVLSet&) = delete;
+
+
+    bool isImplemented() const noexcept override;
+
+
+    // add() adds an element to the set.  If the element is already in the set,
+    // this function has no effect.  Once add() has returned, the element is
+    // seen by every subsequent call to contains() on any thread.
+    void add(const ElementType& element) override;
+
+
+    // contains() returns true if the given element is already in the set,
+    // false otherwise.  Only the replica for the calling thread's NUMA node
+    // is searched.
+    bool contains(const ElementType& element) const override;
+
+
+    // size() returns the number of elements in the set, or the largest
+    // unsigned int if there are more elements than that; size64() always
+    // returns the number of elements.  Both count the elements in whichever
+    // replica is furthest along, which may be on another NUMA node, rather
+    // than replaying the log into the local one.
+    unsigned int size() const noexcept override;
+
+    std::size_t size64() const noexcept;
+
+
+    // replicaCount() returns the number of replicas, which is the number of
+    // NUMA nodes that were online when the set was initialized.
+    unsigned int replicaCount() const noexcept;
+
+
+private:
+    static constexpr unsigned int LogChunkSize = 1024;
+
+    // The number of log entries a replica may fall behind before the
+    // threads adding elements replay the log into it themselves.
+    static constexpr std::size_t MaxReplicaLag = 64 * LogChunkSize;
+
+#ifdef __linux__
+    static constexpr unsigned int MaxCpus = CPU_SETSIZE;
+#else
+    static constexpr unsigned int MaxCpus = 1;
+#endif
+
+    struct LogChunk
+    {
+        alignas(ElementType) unsigned char storage[LogChunkSize * sizeof(ElementType)];
+        LogChunk* next;
+
+        ElementType& entry(unsigned int i) noexcept
+        {
+            return reinterpret_cast<ElementType*>(storage)[i];
+        }
+    };
+
+    struct alignas(64) Replica
+    {
+        std::shared_mutex lock;
+        AVLSet<ElementType> set;
+        LogChunk* chunk;
+        unsigned int offset;
+        std::atomic<std::size_t> applied;
+    };
+
+    Replica* _replicas;
+    unsigned int _replicaCount;
+    unsigned short _cpuToReplica[MaxCpus];
+
+    std::mutex _logLock;
+    LogChunk* _logHead;
+    std::size_t _logHeadIndex;
+    LogChunk* _logTailChunk;
+    std::atomic<std::size_t> _logTail;
+
+    void readTopology();
+
+    Replica& localReplica() const noexcept;
+
+    void catchUp(Replica& r) const;
+
+    void trimLog() noexcept;
+};
+
+
+namespace
+{
+    // Calls "visit" for each number in a Linux CPU or node list, such as
+    // "0-3,8,10-11".
+    template <typename VisitFunction>
+    void forEachInList(const std::string& list, VisitFunction visit)
+    {
+        std::size_t pos = 0;
+        while (pos < list.size())
+        {
+            std::size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+            {
+                end = list.size();
+            }
+            std::string range = list.substr(pos, end - pos);
+            std::size_t dash = range.find('-');
+            try
+            {
+                unsigned long first = std::stoul(range.substr(0, dash));
+                unsigned long last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (unsigned long i = first; i <= last; ++i)
+                {
+                    visit(i);
+                }
+            } catch (const std::exception&)
+            {
+            }
+            pos = end + 1;
+        }
+    }
+}
+
+
+template <typename ElementType>
+ReplicatedAVLSet<ElementType>::ReplicatedAVLSet(bool shouldBalance)
+    : _replicas{nullptr}, _replicaCount{1}, _cpuToReplica{},
+      _logHead{new LogChunk}, _logHeadIndex{0}, _logTail{0}
+{
+    _logHead->next = nullptr;
+    _logTailChunk = _logHead;
+
+    readTopology();
+
+    _replicas = new Replica[_replicaCount];
+    for (unsigned int i = 0; i < _replicaCount; ++i)
+    {
+        _replicas[i].set = AVLSet<ElementType>{shouldBalance};
+        _replicas[i].chunk = _logHead;
+        _replicas[i].offset = 0;
+        _replicas[i].applied.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+template <typename ElementType>
+ReplicatedAVLSet<ElementType>::~ReplicatedAVLSet() noexcept
+{
+    delete[] _replicas;
+
+    std::size_t tail = _logTail.load();
+    std::size_t chunkStart = _logHeadIndex;
+    while (_logHead != nullptr)
+    {
+        LogChunk* chunk = _logHead;
+        _logHead = chunk->next;
+
+        std::size_t count = std::min<std::size_t>(LogChunkSize, tail - chunkStart);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            chunk->entry(i).~ElementType();
+        }
+        delete chunk;
+        chunkStart += LogChunkSize;
+    }
+}
+
+
+template <typename ElementType>
+void ReplicatedAVLSet<ElementType>::readTopology()
+{
+#ifdef __linux__
+    std::ifstream onlineFile{"/sys/devices/system/node/online"};
+    std::string online;
+    if (!std::getline(onlineFile, online))
+    {
+        return;
+    }
+
+    unsigned int replica = 0;
+    forEachInList(online,
+        [&](unsigned long node)
+        {
+            std::ifstream cpuFile{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+            std::string cpus;
+            if (!std::getline(cpuFile, cpus) || cpus.empty())
+            {
+                return;
+            }
+            forEachInList(cpus,
+                [&](unsigned long cpu)
+                {
+                    if (cpu < MaxCpus)
+                    {
+                        _cpuToReplica[cpu] = static_cast<unsigned short>(replica);
+                    }
+                });
+            ++replica;
+        });
+
+    _replicaCount = std::max(replica, 1u);
+#endif
+}
+
+
+template <typename ElementType>
+bool ReplicatedAVLSet<ElementType>::isImplemented() const noexcept
+{
+    return true;
+}
+
+
+template <typename ElementType>
+unsigned int ReplicatedAVLSet<ElementType>::replicaCount() const noexcept
+{
+    return _replicaCount;
+}
+
+
+template <typename ElementType>
+typename ReplicatedAVLSet<ElementType>::Replica& ReplicatedAVLSet<ElementType>::localReplica() const noexcept
+{
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<unsigned int>(cpu) < MaxCpus)
+    {
+        return _replicas[_cpuToReplica[cpu]];
+    }
+#endif
+    return _replicas[0];
+}
+
+
+template <typename ElementType>
+void ReplicatedAVLSet<ElementType>::catchUp(Replica& r) const
+{
+    std::unique_lock<std::shared_mutex> lock{r.lock};
+
+    // The count of applied entries advances along with the replica's place
+    // in the log, one entry at a time, so that the two still agree if
+    // adding an entry throws; the next catch-up then retries that entry.
+    // A replica only moves past the end of a chunk once it has applied an
+    // entry from the next one, which is what lets trimLog() know that the
+    // chunk can be freed.
+    std::size_t tail = _logTail.load(std::memory_order_acquire);
+    std::size_t applied = r.applied.load(std::memory_order_relaxed);
+    while (applied < tail)
+    {
+        if (r.offset == LogChunkSize)
+        {
+            r.chunk = r.chunk->next;
+            r.offset = 0;
+        }
+        r.set.add(r.chunk->entry(r.offset));
+        ++r.offset;
+        ++applied;
+        r.applied.store(applied, std::memory_order_release);
+    }
+}
+
+
+template <typename ElementType>
+void ReplicatedAVLSet<ElementType>::trimLog() noexcept
+{
+    std::size_t oldest = _logTail.load(std::memory_order_relaxed);
+    for (unsigned int i = 0; i < _replicaCount; ++i)
+    {
+        oldest = std::min(oldest, _replicas[i].applied.load(std::memory_order_acquire));
+    }
+
+    while (_logHead != _logTailChunk && _logHeadIndex + LogChunkSize < oldest)
+    {
+        LogChunk* chunk = _logHead;
+        _logHead = chunk->next;
+        _logHeadIndex += LogChunkSize;
+
+        for (unsigned int i = 0; i < LogChunkSize; ++i)
+        {
+            chunk->entry(i).~ElementType();
+        }
+        delete chunk;
+    }
+}
+
+
+template <typename ElementType>
+void ReplicatedAVLSet<ElementType>::add(const ElementType& element)
+{
+    bool lagging = false;
+    {
+        std::lock_guard<std::mutex> lock{_logLock};
+
+        std::size_t tail = _logTail.load(std::memory_order_relaxed);
+        unsigned int offset = static_cast<unsigned int>((tail - _logHeadIndex) % LogChunkSize);
+        if (offset == 0 && tail != _logHeadIndex)
+        {
+            LogChunk* chunk = new LogChunk;
+            chunk->next = nullptr;
+            _logTailChunk->next = chunk;
+            _logTailChunk = chunk;
+        }
+        new (&_logTailChunk->entry(offset)) ElementType(element);
+        _logTail.store(tail + 1, std::memory_order_release);
+
+        trimLog();
+        lagging = tail + 1 - _logHeadIndex > MaxReplicaLag;
+    }
+
+    if (lagging)
+    {
+        for (unsigned int i = 0; i < _replicaCount; ++i)
+        {
+            catchUp(_replicas[i]);
+        }
+    } else
+    {
+        catchUp(localReplica());
+    }
+}
+
+
+template <typename ElementType>
+bool ReplicatedAVLSet<ElementType>::contains(const ElementType& element) const
+{
+    Replica& r = localReplica();
+    if (r.applied.load(std::memory_order_acquire) < _logTail.load(std::memory_order_acquire))
+    {
+        catchUp(r);
+    }
+
+    std::shared_lock<std::shared_mutex> lock{r.lock};
+    return r.set.contains(element);
+}
+
+
+template <typename ElementType>
+unsigned int ReplicatedAVLSet<ElementType>::size() const noexcept
+{
+    return static_cast<unsigned int>(
+        std::min<std::size_t>(size64(), std::numeric_limits<unsigned int>::max()));
+}
+
+
+template <typename ElementType>
+std::size_t ReplicatedAVLSet<ElementType>::size64() const noexcept
+{
+    // Every add() that has returned caught up at least one replica past its
+    // element, so the replica that has applied the most of the log has all
+    // of them.  Counting that one's elements, rather than catching up the
+    // local replica, means size64() never allocates and so can't throw.
+    Replica* newest = &_replicas[0];
+    for (unsigned int i = 1; i < _replicaCount; ++i)
+    {
+        if (_replicas[i].applied.load(std::memory_order_acquire) > newest->applied.load(std::memory_order_acquire))
+        {
+            newest = &_replicas[i];
+        }
+    }
+
+    std::shared_lock<std::shared_mutex> lock{newest->lock};
+    return newest->set.size64();
+}
+
+
+#endif
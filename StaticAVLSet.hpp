@@ -0,0 +1,465 @@
+// StaticAVLSet.hpp
+//
+// A StaticAVLSet is an AVL tree that holds at most Capacity elements, all
+// stored in an array inside the set itself rather than in nodes allocated
+// one at a time.  Nodes refer to their children by their indexes in that
+// array instead of by pointers, so a StaticAVLSet can be copied like any
+// other value, and, for an ElementType that is a literal type, can be
+// built and searched in constant expressions.  A table of keywords, for
+// example, can be built at compile time and placed in read-only memory:
+//
+//     constexpr StaticAVLSet<std::string_view, 4> keywords{"if", "else", "for", "while"};
+//     static_assert(keywords.contains("for"));
+//
+// Since a StaticAVLSet never allocates memory, adding and removing elements
+// take time that depends only on the height of the tree, which makes it
+// suitable for threads that must not call into the allocator.  Nodes freed
+// by removals are kept on a free list, threaded through their children,
+// and reused by later additions; a removed element's value stays in its
+// node until the node is reused.
+//
+// ElementType must be default-constructible, since the array of nodes is
+// initialized when the set is.
+
+#ifndef STATICAVLSET_HPP
+#define STATICAVLSET_HPP
+
+#include <initializer_list>
+
+
+template <typename ElementType, unsigned int Capacity>
+class StaticAVLSet
+{
+public:
+    // Initializes a StaticAVLSet to be empty.
+    constexpr StaticAVLSet() noexcept;
+
+    // Initializes a StaticAVLSet to hold the given elements, any beyond
+    // the set's capacity being left out.
+    constexpr StaticAVLSet(std::initializer_list<ElementType> elements);
+
+
+    // add() adds an element to the set and returns true.  If the element is
+    // already in the set, or the set is full, it returns false instead and
+    // has no effect.  This function always runs in O(log n) time when there
+    // are n elements in the set.
+    constexpr bool add(const ElementType& element);
+
+
+    // remove() removes an element from the set, returning true if it was in
+    // the set and false otherwise.  This function always runs in O(log n)
+    // time.
+    constexpr bool remove(const ElementType& element);
+
+
+    // contains() returns true if the given element is in the set, false
+    // otherwise.  This function always runs in O(log n) time.
+    constexpr bool contains(const ElementType& element) const;
+
+
+    // size() returns the number of elements in the set, and capacity() the
+    // largest number it can hold.
+    constexpr unsigned int size() const noexcept;
+
+    constexpr unsigned int capacity() const noexcept;
+
+
+    // height() returns the height of the AVL tree.  Note that, by definition,
+    // the height of an empty tree is -1.
+    constexpr int height() const noexcept;
+
+
+    // preorder(), inorder() and postorder() call the given "visit" function
+    // for each of the elements in the set, in the order determined by the
+    // respective traversal of the AVL tree.  An inorder traversal visits the
+    // elements in ascending order.
+    template <typename VisitFunction>
+    constexpr void preorder(VisitFunction visit) const;
+
+    template <typename VisitFunction>
+    constexpr void inorder(VisitFunction visit) const;
+
+    template <typename VisitFunction>
+    constexpr void postorder(VisitFunction visit) const;
+
+
+private:
+    // The index that stands for a missing child.
+    static constexpr int None = -1;
+
+    enum Direction {Left = 0, Right = 1};
+
+    struct Node
+    {
+        ElementType value;
+        int child[2];
+        int height;
+    };
+
+    Node _nodes[Capacity];
+    int _root;
+    unsigned int _sz;
+
+    // The number of nodes that have ever been used; every node from there to
+    // the end of the array is free, along with those on the free list.
+    unsigned int _used;
+    int _free;
+
+    constexpr int allocate() noexcept;
+
+    constexpr void release(int t) noexcept;
+
+    constexpr int getHeight(int t) const noexcept;
+
+    constexpr int getBalance(int t) const noexcept;
+
+    constexpr void updateNode(int t) noexcept;
+
+    constexpr int addR(int t, const ElementType& element, bool& added);
+
+    constexpr int removeR(int t, const ElementType& element, bool& removed);
+
+    constexpr int removeMinR(int t, int& min);
+
+    constexpr int rebalance(int t) noexcept;
+
+    constexpr int rotateSingle(int t, int heavy) noexcept;
+
+    constexpr int rotateDouble(int t, int heavy) noexcept;
+
+    template <typename VisitFunction>
+    constexpr void preorderR(VisitFunction& visit, int t) const;
+
+    template <typename VisitFunction>
+    constexpr void inorderR(VisitFunction& visit, int t) const;
+
+    template <typename VisitFunction>
+    constexpr void postorderR(VisitFunction& visit, int t) const;
+};
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr StaticAVLSet<ElementType, Capacity>::StaticAVLSet() noexcept
+    : _nodes{}, _root{None}, _sz{0}, _used{0}, _free{None}
+{
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr StaticAVLSet<ElementType, Capacity>::StaticAVLSet(std::initializer_list<ElementType> elements)
+    : StaticAVLSet{}
+{
+    for (const ElementType& element : elements)
+    {
+        add(element);
+    }
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::getHeight(int t) const noexcept
+{
+    if (t == None)
+    {
+        return -1;
+    }
+    return _nodes[t].height;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::getBalance(int t) const noexcept
+{
+    return getHeight(_nodes[t].child[Left]) - getHeight(_nodes[t].child[Right]);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr void StaticAVLSet<ElementType, Capacity>::updateNode(int t) noexcept
+{
+    int left = getHeight(_nodes[t].child[Left]);
+    int right = getHeight(_nodes[t].child[Right]);
+    _nodes[t].height = 1 + (left > right ? left : right);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::allocate() noexcept
+{
+    if (_free != None)
+    {
+        int t = _free;
+        _free = _nodes[t].child[Left];
+        return t;
+    }
+    if (_used < Capacity)
+    {
+        return static_cast<int>(_used++);
+    }
+    return None;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr void StaticAVLSet<ElementType, Capacity>::release(int t) noexcept
+{
+    _nodes[t].child[Left] = _free;
+    _free = t;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr bool StaticAVLSet<ElementType, Capacity>::add(const ElementType& element)
+{
+    bool added = false;
+    _root = addR(_root, element, added);
+    return added;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::addR(int t, const ElementType& element, bool& added)
+{
+    if (t == None)
+    {
+        int n = allocate();
+        if (n == None)
+        {
+            return None;
+        }
+        ++_sz;
+        _nodes[n].value = element;
+        _nodes[n].child[Left] = None;
+        _nodes[n].child[Right] = None;
+        _nodes[n].height = 0;
+        added = true;
+        return n;
+    }
+    if (_nodes[t].value == element)
+    {
+        return t;
+    }
+
+    int dir = element < _nodes[t].value ? Left : Right;
+    int child = addR(_nodes[t].child[dir], element, added);
+    _nodes[t].child[dir] = child;
+
+    return added ? rebalance(t) : t;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr bool StaticAVLSet<ElementType, Capacity>::remove(const ElementType& element)
+{
+    bool removed = false;
+    _root = removeR(_root, element, removed);
+    return removed;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::removeMinR(int t, int& min)
+{
+    if (_nodes[t].child[Left] == None)
+    {
+        min = t;
+        return _nodes[t].child[Right];
+    }
+    int left = removeMinR(_nodes[t].child[Left], min);
+    _nodes[t].child[Left] = left;
+    return rebalance(t);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::removeR(int t, const ElementType& element, bool& removed)
+{
+    if (t == None)
+    {
+        return None;
+    }
+    if (!(_nodes[t].value == element))
+    {
+        int dir = element < _nodes[t].value ? Left : Right;
+        int child = removeR(_nodes[t].child[dir], element, removed);
+        _nodes[t].child[dir] = child;
+        return removed ? rebalance(t) : t;
+    }
+
+    removed = true;
+    --_sz;
+    int replacement = None;
+    if (_nodes[t].child[Left] == None || _nodes[t].child[Right] == None)
+    {
+        replacement = _nodes[t].child[Left] != None ? _nodes[t].child[Left] : _nodes[t].child[Right];
+    } else
+    {
+        int right = removeMinR(_nodes[t].child[Right], replacement);
+        _nodes[replacement].child[Left] = _nodes[t].child[Left];
+        _nodes[replacement].child[Right] = right;
+    }
+    release(t);
+
+    return replacement == None ? None : rebalance(replacement);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::rebalance(int t) noexcept
+{
+    // As in AVLHookAlgorithms, the rotation is chosen from the balance of
+    // the taller child.
+    updateNode(t);
+    int balance = getBalance(t);
+    if (balance >= -1 && balance <= 1)
+    {
+        return t;
+    }
+
+    int heavy = balance > 0 ? Left : Right;
+    int childBalance = getBalance(_nodes[t].child[heavy]);
+    if (heavy == Left ? childBalance < 0 : childBalance > 0)
+    {
+        return rotateDouble(t, heavy);
+    }
+    return rotateSingle(t, heavy);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::rotateSingle(int t, int heavy) noexcept
+{
+    int light = 1 - heavy;
+    int a = _nodes[t].child[heavy];
+
+    _nodes[t].child[heavy] = _nodes[a].child[light];
+    _nodes[a].child[light] = t;
+
+    updateNode(t);
+    updateNode(a);
+
+    return a;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::rotateDouble(int t, int heavy) noexcept
+{
+    int light = 1 - heavy;
+    int a = _nodes[t].child[heavy];
+    int b = _nodes[a].child[light];
+
+    _nodes[a].child[light] = _nodes[b].child[heavy];
+    _nodes[t].child[heavy] = _nodes[b].child[light];
+    _nodes[b].child[heavy] = a;
+    _nodes[b].child[light] = t;
+
+    updateNode(a);
+    updateNode(t);
+    updateNode(b);
+
+    return b;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr bool StaticAVLSet<ElementType, Capacity>::contains(const ElementType& element) const
+{
+    int t = _root;
+    while (t != None)
+    {
+        if (_nodes[t].value == element)
+        {
+            return true;
+        }
+        t = _nodes[t].child[element < _nodes[t].value ? Left : Right];
+    }
+    return false;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr unsigned int StaticAVLSet<ElementType, Capacity>::size() const noexcept
+{
+    return _sz;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr unsigned int StaticAVLSet<ElementType, Capacity>::capacity() const noexcept
+{
+    return Capacity;
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+constexpr int StaticAVLSet<ElementType, Capacity>::height() const noexcept
+{
+    return getHeight(_root);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::preorderR(VisitFunction& visit, int t) const
+{
+    if (t != None)
+    {
+        visit(_nodes[t].value);
+        preorderR(visit, _nodes[t].child[Left]);
+        preorderR(visit, _nodes[t].child[Right]);
+    }
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::preorder(VisitFunction visit) const
+{
+    preorderR(visit, _root);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::inorderR(VisitFunction& visit, int t) const
+{
+    if (t != None)
+    {
+        inorderR(visit, _nodes[t].child[Left]);
+        visit(_nodes[t].value);
+        inorderR(visit, _nodes[t].child[Right]);
+    }
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::inorder(VisitFunction visit) const
+{
+    inorderR(visit, _root);
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::postorderR(VisitFunction& visit, int t) const
+{
+    if (t != None)
+    {
+        postorderR(visit, _nodes[t].child[Left]);
+        postorderR(visit, _nodes[t].child[Right]);
+        visit(_nodes[t].value);
+    }
+}
+
+
+template <typename ElementType, unsigned int Capacity>
+template <typename VisitFunction>
+constexpr void StaticAVLSet<ElementType, Capacity>::postorder(VisitFunction visit) const
+{
+    postorderR(visit, _root);
+}
+
+
+#endif
@@ -0,0 +1,179 @@
+// ThreadSlots.hpp
+//
+// ThreadSlots is a growable list of slots through which threads publish
+// something to one another, such as the epoch a reader entered in (see
+// EpochReclaimer.hpp) or a request waiting to be combined (see
+// FlatCombiningAVLSet.hpp).  A thread claims a slot, publishes through it,
+// and releases it when it's done, while other threads scan every slot to
+// see what has been published.
+//
+// Claiming never waits.  A thread first tries the slot it claimed last
+// time, which is usually free again and still in its cache, then any other
+// free slot, and if every slot is in use, it adds a new one to the list.
+// So there are never more slots than the most threads that have held one at
+// the same time, and no thread is ever turned away, however many there are
+// or however deeply their claims are nested.  Slots are only freed when the
+// ThreadSlots is destroyed.
+//
+// Each slot holds a SlotData, which is default-constructed before the slot
+// is added to the list, so other threads scanning it see that initial value
+// until the slot's owner publishes something else.
+
+#ifndef THREADSLOTS_HPP
+#define THREADSLOTS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+
+template <typename SlotData>
+class ThreadSlots
+{
+public:
+    // A Slot holds its SlotData, which it inherits, on a cache line of its
+    // own, so that threads publishing through neighboring slots don't
+    // contend for the line.
+    struct alignas(64) Slot : SlotData
+    {
+        std::atomic<bool> inUse{false};
+        Slot* next{nullptr};
+    };
+
+public:
+    // Initializes a ThreadSlots with no slots.
+    ThreadSlots();
+
+    // Frees every slot.  No thread may be holding one.
+    ~ThreadSlots() noexcept;
+
+    ThreadSlots(const ThreadSlots&) = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+
+    // claim() returns a slot that no other thread holds, adding one to the
+    // list if every slot is already held.  It only throws if it can't
+    // allocate a new slot.
+    Slot& claim();
+
+
+    // release() gives up a slot that the calling thread claimed, so that it
+    // can be claimed again.
+    static void release(Slot& slot) noexcept;
+
+
+    // forEach() calls the given "visit" function with every slot in the
+    // list, whether or not it is held.  Slots added while it runs may or may
+    // not be visited.
+    template <typename VisitFunction>
+    void forEach(VisitFunction&& visit) const;
+
+
+private:
+    // Each thread remembers the last slot it claimed from any ThreadSlots of
+    // this type, along with the id of the ThreadSlots it came from.  Ids are
+    // never reused, so a remembered slot whose id matches still exists.
+    struct LastClaimed
+    {
+        std::uint64_t owner;
+        Slot* slot;
+    };
+
+    inline static std::atomic<std::uint64_t> _nextId{1};
+
+    std::atomic<Slot*> _head;
+    std::uint64_t _id;
+
+    static bool tryClaim(Slot* slot) noexcept;
+
+    static LastClaimed& lastClaimed() noexcept;
+};
+
+
+template <typename SlotData>
+ThreadSlots<SlotData>::ThreadSlots()
+    : _head{nullptr}, _id{_nextId.fetch_add(1, std::memory_order_relaxed)}
+{
+}
+
+
+template <typename SlotData>
+ThreadSlots<SlotData>::~ThreadSlots() noexcept
+{
+    Slot* slot = _head.load(std::memory_order_relaxed);
+    while (slot != nullptr)
+    {
+        Slot* next = slot->next;
+        delete slot;
+        slot = next;
+    }
+}
+
+
+template <typename SlotData>
+bool ThreadSlots<SlotData>::tryClaim(Slot* slot) noexcept
+{
+    return !slot->inUse.load(std::memory_order_relaxed)
+        && !slot->inUse.exchange(true, std::memory_order_acquire);
+}
+
+
+template <typename SlotData>
+typename ThreadSlots<SlotData>::LastClaimed& ThreadSlots<SlotData>::lastClaimed() noexcept
+{
+    static thread_local LastClaimed last{0, nullptr};
+    return last;
+}
+
+
+template <typename SlotData>
+typename ThreadSlots<SlotData>::Slot& ThreadSlots<SlotData>::claim()
+{
+    LastClaimed& last = lastClaimed();
+    if (last.owner == _id && tryClaim(last.slot))
+    {
+        return *last.slot;
+    }
+
+    Slot* slot = _head.load(std::memory_order_acquire);
+    while (slot != nullptr && !tryClaim(slot))
+    {
+        slot = slot->next;
+    }
+
+    if (slot == nullptr)
+    {
+        // The new slot is claimed before it's published, so no other thread
+        // can claim it first, and its SlotData is visible to every thread
+        // that finds it in the list.
+        slot = new Slot;
+        slot->inUse.store(true, std::memory_order_relaxed);
+        slot->next = _head.load(std::memory_order_relaxed);
+        while (!_head.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    last = LastClaimed{_id, slot};
+    return *slot;
+}
+
+
+template <typename SlotData>
+void ThreadSlots<SlotData>::release(Slot& slot) noexcept
+{
+    slot.inUse.store(false, std::memory_order_release);
+}
+
+
+template <typename SlotData>
+template <typename VisitFunction>
+void ThreadSlots<SlotData>::forEach(VisitFunction&& visit) const
+{
+    for (Slot* slot = _head.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+    {
+        visit(*slot);
+    }
+}
+
+
+#endif
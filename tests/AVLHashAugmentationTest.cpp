@@ -0,0 +1,176 @@
+// AVLHashAugmentationTest.cpp
+//
+// A test of AVLHashAugmentation and AVLSet::differences().  Sets with the
+// same elements, added in different orders, must have the same fingerprint,
+// and differences() must report exactly the elements that are in only one
+// of two sets, checked against std::set.  Elements whose hashes are 0, such
+// as the int 0 and the double 0.0, are checked separately, since a value
+// that mixed to the identity would leave no trace in a fingerprint.
+//
+// Build it with the repository root on the include path, for example:
+//
+//     g++ -std=c++17 -O2 -I.. AVLHashAugmentationTest.cpp -o hash
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+#include "AVLSet.hpp"
+
+
+namespace
+{
+    using HashedSet = AVLSet<int, AVLHashAugmentation<int>>;
+
+
+    void fail(const char* message)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", message);
+        std::exit(1);
+    }
+
+
+    // differencesOf() returns what a.differences(b) reports, checking that
+    // no element is reported twice.
+    template <typename SetType>
+    auto differencesOf(const SetType& a, const SetType& b)
+    {
+        using ElementType = typename std::iterator_traits<typename SetType::ConstIterator>::value_type;
+
+        std::map<ElementType, bool> reported;
+        a.differences(b,
+            [&](const ElementType& element, bool inA)
+            {
+                if (!reported.emplace(element, inA).second)
+                {
+                    fail("differences() reported an element twice");
+                }
+            });
+        return reported;
+    }
+
+
+    void testZeroHashes()
+    {
+        if (AVLHashAugmentation<int>::of(0) == AVLHashAugmentation<int>::identity()
+            || AVLHashAugmentation<double>::of(0.0) == AVLHashAugmentation<double>::identity())
+        {
+            fail("a value whose hash is 0 has the identity fingerprint");
+        }
+
+        HashedSet empty;
+        HashedSet zero;
+        zero.add(0);
+        if (zero.aggregate() == empty.aggregate())
+        {
+            fail("{0} has the same fingerprint as {}");
+        }
+
+        HashedSet digits;
+        for (int i = 0; i < 10; ++i)
+        {
+            digits.add(i);
+        }
+        if (differencesOf(digits, empty).size() != 10 || differencesOf(empty, digits).size() != 10)
+        {
+            fail("differences() skipped an element whose hash is 0");
+        }
+
+        AVLSet<double, AVLHashAugmentation<double>> emptyDoubles;
+        AVLSet<double, AVLHashAugmentation<double>> zeroDouble;
+        zeroDouble.add(0.0);
+        if (differencesOf(zeroDouble, emptyDoubles).size() != 1)
+        {
+            fail("differences() skipped 0.0");
+        }
+    }
+
+
+    void testRandomSets()
+    {
+        std::mt19937 random{1};
+
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            std::set<int> common;
+            int n = static_cast<int>(random() % 300);
+            for (int i = 0; i < n; ++i)
+            {
+                common.insert(static_cast<int>(random() % 1000));
+            }
+
+            std::vector<int> orderA{common.begin(), common.end()};
+            std::vector<int> orderB = orderA;
+            std::shuffle(orderA.begin(), orderA.end(), random);
+            std::shuffle(orderB.begin(), orderB.end(), random);
+
+            HashedSet a;
+            HashedSet b;
+            for (int element : orderA)
+            {
+                a.add(element);
+            }
+            for (int element : orderB)
+            {
+                b.add(element);
+            }
+            if (a.aggregate() != b.aggregate())
+            {
+                fail("sets with the same elements have different fingerprints");
+            }
+
+            std::set<int> onlyA = common;
+            std::set<int> onlyB = common;
+            for (int i = static_cast<int>(random() % 6); i > 0; --i)
+            {
+                int element = static_cast<int>(random() % 1000);
+                if (random() % 2 == 0)
+                {
+                    a.add(element);
+                    onlyA.insert(element);
+                } else
+                {
+                    b.add(element);
+                    onlyB.insert(element);
+                }
+            }
+
+            std::map<int, bool> expected;
+            for (int element : onlyA)
+            {
+                if (onlyB.count(element) == 0)
+                {
+                    expected[element] = true;
+                }
+            }
+            for (int element : onlyB)
+            {
+                if (onlyA.count(element) == 0)
+                {
+                    expected[element] = false;
+                }
+            }
+
+            if (differencesOf(a, b) != expected)
+            {
+                fail("differences() differs from the reference sets");
+            }
+            if ((a.aggregate() == b.aggregate()) != expected.empty())
+            {
+                fail("fingerprints disagree with the contents of the sets");
+            }
+        }
+    }
+}
+
+
+int main()
+{
+    testZeroHashes();
+    testRandomSets();
+    std::printf("AVLHashAugmentation tests passed\n");
+    return 0;
+}
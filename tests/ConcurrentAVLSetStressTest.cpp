@@ -0,0 +1,144 @@
+// ConcurrentAVLSetStressTest.cpp
+//
+// A stress test and scaling benchmark for ConcurrentAVLSet.  Several threads
+// add random elements to one set while searching it, each checking that
+// every element it has added is found from then on.  Afterward, the set is
+// checked against a reference std::set of everything that was added: its
+// size, every element in the key space, and its height, which must be
+// within the AVL bound.  Then the same workload is timed with 1, 2, 4 and 8
+// threads.
+//
+// Build it with the repository root on the include path, for example:
+//
+//     g++ -std=c++17 -O2 -I.. ConcurrentAVLSetStressTest.cpp -o stress -lpthread
+//
+// Under ThreadSanitizer (-fsanitize=thread), it runs without data races,
+// but TSan reports a lock-order inversion.  That's expected: every thread
+// locks nodes parent before child, but a rotation makes a child the parent
+// of its old parent, so TSan sees the same two locks taken in both orders
+// at different times.  That can't deadlock: a link between two nodes only
+// changes while both are locked, so two threads can never hold each other's
+// next lock, one believing a node is the parent and the other its child.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include "ConcurrentAVLSet.hpp"
+
+
+namespace
+{
+    constexpr int KeySpace = 200000;
+    constexpr int OperationsPerThread = 50000;
+
+
+    void fail(const char* message)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", message);
+        std::exit(1);
+    }
+
+
+    // run() has the given number of threads add to and search the set, and
+    // records everything they added in "added".
+    void run(ConcurrentAVLSet<int>& s, int threads, std::set<int>& added)
+    {
+        std::mutex addedLock;
+        std::vector<std::thread> workers;
+
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(
+                [&s, &added, &addedLock, t]()
+                {
+                    std::mt19937 random{static_cast<unsigned int>(t + 1)};
+                    std::vector<int> mine;
+
+                    for (int i = 0; i < OperationsPerThread; ++i)
+                    {
+                        int element = static_cast<int>(random() % KeySpace);
+                        s.add(element);
+                        mine.push_back(element);
+
+                        if (!s.contains(element))
+                        {
+                            fail("an element was not found right after it was added");
+                        }
+                        if (!s.contains(mine[random() % mine.size()]))
+                        {
+                            fail("an element was lost after it was added");
+                        }
+                        s.contains(static_cast<int>(random() % KeySpace));
+                    }
+
+                    std::lock_guard<std::mutex> lock{addedLock};
+                    added.insert(mine.begin(), mine.end());
+                });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+
+    void check(const ConcurrentAVLSet<int>& s, const std::set<int>& added)
+    {
+        if (s.size64() != added.size())
+        {
+            fail("size() differs from the number of distinct elements added");
+        }
+
+        for (int element = 0; element < KeySpace; ++element)
+        {
+            if (s.contains(element) != (added.count(element) != 0))
+            {
+                fail("contains() differs from the reference set");
+            }
+        }
+
+        double bound = 1.45 * std::log2(static_cast<double>(added.size()) + 2);
+        if (s.height() > bound)
+        {
+            fail("the tree is taller than an AVL tree can be");
+        }
+    }
+}
+
+
+int main()
+{
+    {
+        ConcurrentAVLSet<int> s;
+        std::set<int> added;
+        run(s, 8, added);
+        check(s, added);
+        std::printf("stress test passed: %zu elements, height %d\n", s.size64(), s.height());
+    }
+
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        ConcurrentAVLSet<int> s;
+        std::set<int> added;
+
+        auto start = std::chrono::steady_clock::now();
+        run(s, threads, added);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        check(s, added);
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double operations = 3.0 * OperationsPerThread * threads;
+        std::printf("%d threads: %.3f s, %.2f million operations per second\n",
+            threads, seconds, operations / seconds / 1e6);
+    }
+
+    return 0;
+}
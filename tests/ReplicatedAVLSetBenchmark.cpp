@@ -0,0 +1,204 @@
+// ReplicatedAVLSetBenchmark.cpp
+//
+// A benchmark of ReplicatedAVLSet's local-replica lookups against lookups in
+// a single AVLSet whose nodes all live in one NUMA node's memory.  The
+// AVLSet is built by a thread pinned to the first node, so its nodes are
+// placed there; then a thread pinned to each node in turn times the same
+// random lookups in both sets.  On the first node, both are local.  On every
+// other node, the AVLSet's lookups are remote, while the ReplicatedAVLSet's
+// go to that node's own replica, so the gap between the two columns there is
+// what replication saves.
+//
+// It runs on a machine with one NUMA node, too, where there's only one
+// replica and both columns should match; the numbers are only interesting
+// on a multi-socket machine.
+//
+// Build it with the repository root on the include path, for example:
+//
+//     g++ -std=c++17 -O2 -I.. ReplicatedAVLSetBenchmark.cpp -o replicated -lpthread
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AVLSet.hpp"
+#include "ReplicatedAVLSet.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+namespace
+{
+    constexpr int Elements = 1 << 20;
+    constexpr int Lookups = 1 << 21;
+
+
+    // parseList() returns the numbers in a Linux CPU or node list, such as
+    // "0-3,8,10-11".
+    std::vector<int> parseList(const std::string& list)
+    {
+        std::vector<int> numbers;
+        std::size_t pos = 0;
+        while (pos < list.size())
+        {
+            std::size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+            {
+                end = list.size();
+            }
+            std::string range = list.substr(pos, end - pos);
+            std::size_t dash = range.find('-');
+            int first = std::atoi(range.substr(0, dash).c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+            for (int i = first; i <= last; ++i)
+            {
+                numbers.push_back(i);
+            }
+            pos = end + 1;
+        }
+        return numbers;
+    }
+
+
+    // firstCpuOfEachNode() returns one CPU on each NUMA node that is online,
+    // or a single -1, meaning "don't pin", if the topology can't be read.
+    std::vector<int> firstCpuOfEachNode()
+    {
+        std::vector<int> cpus;
+
+#ifdef __linux__
+        std::ifstream onlineFile{"/sys/devices/system/node/online"};
+        std::string online;
+        if (std::getline(onlineFile, online))
+        {
+            for (int node : parseList(online))
+            {
+                std::ifstream cpuFile{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+                std::string cpuList;
+                if (std::getline(cpuFile, cpuList) && !cpuList.empty())
+                {
+                    cpus.push_back(parseList(cpuList).front());
+                }
+            }
+        }
+#endif
+
+        if (cpus.empty())
+        {
+            cpus.push_back(-1);
+        }
+        return cpus;
+    }
+
+
+    // runOn() calls the given function on a new thread pinned to the given
+    // CPU, and waits for it to finish.
+    template <typename Function>
+    void runOn(int cpu, Function function)
+    {
+        std::thread worker{
+            [cpu, &function]()
+            {
+#ifdef __linux__
+                if (cpu >= 0)
+                {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(cpu, &set);
+                    sched_setaffinity(0, sizeof(set), &set);
+                }
+#endif
+                function();
+            }};
+        worker.join();
+    }
+
+
+    // timeLookups() returns the average time, in nanoseconds, that the given
+    // set takes to look up each of the keys, and adds to "found" the number
+    // of them it finds, so that the lookups can't be optimized away.
+    template <typename SetType>
+    double timeLookups(const SetType& s, const std::vector<int>& keys, long& found)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int key : keys)
+        {
+            found += s.contains(key) ? 1 : 0;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / keys.size();
+    }
+}
+
+
+int main()
+{
+    std::vector<int> cpus = firstCpuOfEachNode();
+
+    // Every other key is in the sets, so half of the lookups succeed.
+    std::vector<int> elements;
+    for (int i = 0; i < Elements; ++i)
+    {
+        elements.push_back(2 * i);
+    }
+    std::shuffle(elements.begin(), elements.end(), std::mt19937{1});
+
+    std::vector<int> keys;
+    std::mt19937 random{2};
+    for (int i = 0; i < Lookups; ++i)
+    {
+        keys.push_back(static_cast<int>(random() % (2 * Elements)));
+    }
+
+    AVLSet<int> single;
+    ReplicatedAVLSet<int> replicated;
+    runOn(cpus.front(),
+        [&]()
+        {
+            for (int element : elements)
+            {
+                single.add(element);
+                replicated.add(element);
+            }
+        });
+
+    std::printf("%zu NUMA nodes, %u replicas, %d elements, %d lookups per run\n",
+        cpus.size(), replicated.replicaCount(), Elements, Lookups);
+    std::printf("%6s %6s %22s %22s\n", "node", "cpu", "AVLSet (ns/lookup)", "replicated (ns/lookup)");
+
+    long found = 0;
+    for (std::size_t node = 0; node < cpus.size(); ++node)
+    {
+        double singleTime = 0;
+        double replicatedTime = 0;
+        runOn(cpus[node],
+            [&]()
+            {
+                // The first lookup on each node replays the log into its
+                // replica, which is then warm, like the AVLSet.
+                timeLookups(replicated, keys, found);
+                timeLookups(single, keys, found);
+
+                singleTime = timeLookups(single, keys, found);
+                replicatedTime = timeLookups(replicated, keys, found);
+            });
+
+        std::printf("%6zu %6d %22.1f %22.1f\n", node, cpus[node], singleTime, replicatedTime);
+    }
+
+    // Each of the four runs on each node should have found every even key.
+    long evenKeys = std::count_if(keys.begin(), keys.end(), [](int key) { return key % 2 == 0; });
+    if (found != 4 * static_cast<long>(cpus.size()) * evenKeys)
+    {
+        std::printf("FAILED: the sets found different keys\n");
+        return 1;
+    }
+    return 0;
+}